@@ -0,0 +1,170 @@
+#pragma once
+// A* and IDA* as pathfinding/ and w7/pathfinder.cpp had them before grid::GridSearch, kept only
+// to time the old call sites against it. Drawing and logging are left out, IDA* copies the tip
+// of its path instead of keeping a reference that push_back can move and paths are built back to
+// front and reversed once instead of inserting at the front, the rest is as it was.
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "w8/dungeonUtils.h"
+#include "w8/math.h"
+
+namespace legacy
+{
+  constexpr char water = 'o';
+
+  template<typename T>
+  static size_t coord_to_idx(T x, T y, size_t w)
+  {
+    return size_t(y) * w + size_t(x);
+  }
+
+  static float heuristic(IVec2 lhs, IVec2 rhs)
+  {
+    return sqrtf(sqr(float(lhs.x - rhs.x)) + sqr(float(lhs.y - rhs.y)));
+  };
+
+  static std::vector<IVec2> reconstruct_path(std::vector<IVec2> prev, IVec2 to, size_t width)
+  {
+    IVec2 curPos = to;
+    std::vector<IVec2> res = {curPos};
+    while (prev[coord_to_idx(curPos.x, curPos.y, width)] != IVec2{-1, -1})
+    {
+      curPos = prev[coord_to_idx(curPos.x, curPos.y, width)];
+      res.push_back(curPos);
+    }
+    std::reverse(res.begin(), res.end());
+    return res;
+  }
+
+  static std::vector<IVec2> find_path_a_star(const char *input, size_t width, size_t height, IVec2 from, IVec2 to,
+                                             IVec2 lim_min, IVec2 lim_max, float weight = 1.f)
+  {
+    if (from.x < 0 || from.y < 0 || from.x >= int(width) || from.y >= int(height))
+      return std::vector<IVec2>();
+    size_t inpSize = width * height;
+
+    std::vector<float> g(inpSize, std::numeric_limits<float>::max());
+    std::vector<float> f(inpSize, std::numeric_limits<float>::max());
+    std::vector<IVec2> prev(inpSize, {-1,-1});
+
+    auto getG = [&](IVec2 p) -> float { return g[coord_to_idx(p.x, p.y, width)]; };
+    auto getF = [&](IVec2 p) -> float { return f[coord_to_idx(p.x, p.y, width)]; };
+
+    g[coord_to_idx(from.x, from.y, width)] = 0;
+    f[coord_to_idx(from.x, from.y, width)] = weight * heuristic(from, to);
+
+    std::vector<IVec2> openList = {from};
+    std::vector<IVec2> closedList;
+
+    while (!openList.empty())
+    {
+      size_t bestIdx = 0;
+      float bestScore = getF(openList[0]);
+      for (size_t i = 1; i < openList.size(); ++i)
+      {
+        float score = getF(openList[i]);
+        if (score < bestScore)
+        {
+          bestIdx = i;
+          bestScore = score;
+        }
+      }
+      if (openList[bestIdx] == to)
+        return reconstruct_path(prev, to, width);
+      IVec2 curPos = openList[bestIdx];
+      openList.erase(openList.begin() + std::ptrdiff_t(bestIdx));
+      if (std::find(closedList.begin(), closedList.end(), curPos) != closedList.end())
+        continue;
+      closedList.emplace_back(curPos);
+      auto checkNeighbour = [&](IVec2 p)
+      {
+        // out of bounds
+        if (p.x < lim_min.x || p.y < lim_min.y || p.x >= lim_max.x || p.y >= lim_max.y)
+          return;
+        size_t idx = coord_to_idx(p.x, p.y, width);
+        // not empty
+        if (input[idx] == dungeon::wall)
+          return;
+        float edgeWeight = input[idx] == water ? 10.f : 1.f;
+        float gScore = getG(curPos) + 1.f * edgeWeight; // we're exactly 1 unit away
+        if (gScore < getG(p))
+        {
+          prev[idx] = curPos;
+          g[idx] = gScore;
+          f[idx] = gScore + weight * heuristic(p, to);
+        }
+        bool found = std::find(openList.begin(), openList.end(), p) != openList.end();
+        if (!found)
+          openList.emplace_back(p);
+      };
+      checkNeighbour({curPos.x + 1, curPos.y + 0});
+      checkNeighbour({curPos.x - 1, curPos.y + 0});
+      checkNeighbour({curPos.x + 0, curPos.y + 1});
+      checkNeighbour({curPos.x + 0, curPos.y - 1});
+    }
+    // empty path
+    return std::vector<IVec2>();
+  }
+
+  static float ida_star_search(const char *input, size_t width, size_t height, std::vector<IVec2> &path,
+                               const float g, const float bound, IVec2 to)
+  {
+    const IVec2 tip = path.back();
+    const float f = g + heuristic(tip, to);
+    if (f > bound)
+      return f;
+    if (tip == to)
+      return -f;
+    float min = FLT_MAX;
+    auto checkNeighbour = [&](IVec2 p) -> float
+    {
+      // out of bounds
+      if (p.x < 0 || p.y < 0 || p.x >= int(width) || p.y >= int(height))
+        return 0.f;
+      size_t idx = coord_to_idx(p.x, p.y, width);
+      // not empty
+      if (input[idx] == dungeon::wall)
+        return 0.f;
+      if (std::find(path.begin(), path.end(), p) != path.end())
+        return 0.f;
+      path.push_back(p);
+      float weight = input[idx] == water ? 10.f : 1.f;
+      float gScore = g + 1.f * weight; // we're exactly 1 unit away
+      const float t = ida_star_search(input, width, height, path, gScore, bound, to);
+      if (t < 0.f)
+        return t;
+      if (t < min)
+        min = t;
+      path.pop_back();
+      return t;
+    };
+    float lv = checkNeighbour({tip.x + 1, tip.y + 0});
+    if (lv < 0.f) return lv;
+    float rv = checkNeighbour({tip.x - 1, tip.y + 0});
+    if (rv < 0.f) return rv;
+    float tv = checkNeighbour({tip.x + 0, tip.y + 1});
+    if (tv < 0.f) return tv;
+    float bv = checkNeighbour({tip.x + 0, tip.y - 1});
+    if (bv < 0.f) return bv;
+    return min;
+  }
+
+  static std::vector<IVec2> find_ida_star_path(const char *input, size_t width, size_t height, IVec2 from, IVec2 to)
+  {
+    float bound = heuristic(from, to);
+    std::vector<IVec2> path = {from};
+    while (true)
+    {
+      const float t = ida_star_search(input, width, height, path, 0.f, bound, to);
+      if (t < 0.f)
+        return path;
+      if (t == FLT_MAX)
+        return {};
+      bound = t;
+    }
+    return {};
+  }
+};
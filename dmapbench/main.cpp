@@ -0,0 +1,606 @@
+// Headless benchmark of the dijkstra map algorithms on w8 dungeons. Every variant is checked
+// to be bit-exact with scan_dmap, the reference everything else has to agree with, except the
+// pyramid, far values of it aren't distances, it's checked to lead every follower to a source.
+// A* and IDA* are timed against the code they replaced, both have to find paths of the same length.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "w8/dungeonGen.h"
+#include "w8/dungeonUtils.h"
+#include "w8/rng.h"
+#include "w4/dmapField.h"
+#include "w4/dmapPyramid.h"
+#include "legacySearch.h"
+
+using RowSearch = grid::GridSearch<grid::Neighbourhood4, grid::UniformCost<dungeon::wall>, grid::Manhattan>;
+using TiledSearch = grid::GridSearch<grid::Neighbourhood4, grid::UniformCost<dungeon::wall>, grid::Manhattan, grid::Tiled8>;
+// the searches pathfinding/ and the w7 portal prebuild use
+using NavSearch = grid::GridSearch<grid::Neighbourhood4, grid::WeightedCost<dungeon::wall, legacy::water, 10>, grid::Euclidean>;
+using PortalSearch = RowSearch;
+
+struct Generator
+{
+  const char *name;
+  size_t maxSize; // plain inverse generators probe at random and get too slow on big maps
+  void (*gen)(char *tiles, size_t n, rng::Rng &rng);
+};
+
+static const Generator generators[] = {
+  {"drunk", 4096, [](char *tiles, size_t n, rng::Rng &rng)
+    { gen_drunk_dungeon(tiles, n, n, std::max(n * n / 2048, size_t(1)), 600, rng); }},
+  {"cellular", 4096, [](char *tiles, size_t n, rng::Rng &rng) { gen_cellular_dungeon(tiles, n, n, 0.45f, 10, rng); }},
+  {"inv_room", 256, [](char *tiles, size_t n, rng::Rng &rng) { gen_inv_room_dungeon(tiles, n, n, n * n / 40, 3, 20, rng); }},
+  {"inv_room_frontier", 4096, [](char *tiles, size_t n, rng::Rng &rng)
+    { gen_inv_room_dungeon_frontier(tiles, n, n, n * n / 40, 3, 20, rng); }},
+};
+
+struct Options
+{
+  std::vector<size_t> sizes = {64, 256, 1024, 2048};
+  std::vector<size_t> sources = {1, 16, 256};
+  std::vector<std::string> gens;
+  size_t followers = 5000;
+  size_t queries = 20;
+  size_t repeats = 5;
+  unsigned seed = 1;
+  bool json = false;
+};
+
+struct Result
+{
+  std::string gen;
+  size_t size;
+  size_t sources; // queries for the path searches
+  std::string variant;
+  size_t repeats;
+  double minMs;
+  double medianMs;
+  int exact; // -1 if there is nothing to compare, for the pyramid if followers reach the sources
+};
+
+static std::vector<size_t> parse_list(const char *arg)
+{
+  std::vector<size_t> res;
+  for (const char *p = arg; *p;)
+  {
+    char *end = nullptr;
+    const size_t value = size_t(strtoull(p, &end, 10));
+    if (end == p)
+      break;
+    res.push_back(value);
+    p = *end == ',' ? end + 1 : end;
+  }
+  return res;
+}
+
+static bool parse_options(int argc, const char **argv, Options &opt)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "--json")
+      opt.json = true;
+    else if (arg == "--csv")
+      opt.json = false;
+    else if (arg == "--sizes" && hasValue)
+      opt.sizes = parse_list(argv[++i]);
+    else if (arg == "--sources" && hasValue)
+      opt.sources = parse_list(argv[++i]);
+    else if (arg == "--followers" && hasValue)
+      opt.followers = size_t(strtoull(argv[++i], nullptr, 10));
+    else if (arg == "--queries" && hasValue)
+      opt.queries = size_t(strtoull(argv[++i], nullptr, 10));
+    else if (arg == "--repeats" && hasValue)
+      opt.repeats = std::max(size_t(strtoull(argv[++i], nullptr, 10)), size_t(1));
+    else if (arg == "--seed" && hasValue)
+      opt.seed = unsigned(strtoul(argv[++i], nullptr, 10));
+    else if (arg == "--gen" && hasValue)
+      opt.gens.push_back(argv[++i]);
+    else
+    {
+      fprintf(stderr, "usage: %s [--sizes 64,256,1024,2048] [--sources 1,16,256] [--gen drunk|cellular|inv_room|inv_room_frontier]... "
+                      "[--followers 5000] [--queries 20] [--repeats 5] [--seed 1] [--csv|--json]\n", argv[0]);
+      return false;
+    }
+  }
+  return true;
+}
+
+// runs f repeats times, min and median in milliseconds
+template<typename Callable>
+static void time_runs(size_t repeats, Result &res, Callable f)
+{
+  std::vector<double> ms;
+  for (size_t i = 0; i < repeats; ++i)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const auto end = std::chrono::steady_clock::now();
+    ms.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+  }
+  std::sort(ms.begin(), ms.end());
+  res.repeats = repeats;
+  res.minMs = ms.front();
+  res.medianMs = ms[ms.size() / 2];
+}
+
+static bool same_bits(const std::vector<float> &a, const std::vector<float> &b)
+{
+  return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+}
+
+// map with 0 on every source and invalid everywhere else, row-major
+static std::vector<float> seeded_map(size_t count, const std::vector<size_t> &sources)
+{
+  std::vector<float> map(count, dmaps::invalid_tile_value);
+  for (size_t idx : sources)
+    map[idx] = 0.f;
+  return map;
+}
+
+static std::vector<float> scan_reference(const std::vector<char> &tiles, size_t n, const std::vector<size_t> &sources,
+                                         Result &res)
+{
+  std::vector<float> ref;
+  time_runs(1, res, [&]()
+  {
+    ref = seeded_map(tiles.size(), sources);
+    RowSearch::scan_dmap(ref.data(), tiles.data(), n, n);
+  });
+  return ref;
+}
+
+// every source takes one random step, what followers' targets do between turns
+static std::vector<size_t> move_sources(const std::vector<char> &tiles, size_t n, const std::vector<size_t> &sources,
+                                        rng::Rng &rng)
+{
+  std::vector<size_t> res;
+  for (size_t idx : sources)
+  {
+    std::vector<size_t> options = {idx};
+    RowSearch::for_each_neighbour(tiles.data(), n, int(idx % n), int(idx / n), 0, 0, int(n), int(n),
+                                  [&](size_t nidx, int, int, float) { options.push_back(nidx); });
+    res.push_back(options[rng.index(options.size())]);
+  }
+  std::sort(res.begin(), res.end());
+  res.erase(std::unique(res.begin(), res.end()), res.end());
+  return res;
+}
+
+// where a follower steps from idx, its lowest neighbour or idx itself if none is lower
+template<typename Callable>
+static size_t step_down(const std::vector<char> &tiles, size_t n, size_t idx, Callable value)
+{
+  size_t best = idx;
+  float bestVal = value(idx);
+  RowSearch::for_each_neighbour(tiles.data(), n, int(idx % n), int(idx / n), 0, 0, int(n), int(n),
+    [&](size_t nidx, int, int, float)
+    {
+      const float nval = value(nidx);
+      if (nval < bestVal)
+      {
+        best = nidx;
+        bestVal = nval;
+      }
+    });
+  return best;
+}
+
+// followers keep stepping down until none is lower, true if all of them stop on a source
+template<typename Callable>
+static bool walk_followers(const std::vector<char> &tiles, size_t n, std::vector<size_t> followers, Callable value)
+{
+  bool allReached = true;
+  for (size_t idx : followers)
+  {
+    // values go down with every step, more steps than tiles means they don't
+    for (size_t step = 0; step < tiles.size(); ++step)
+    {
+      const size_t next = step_down(tiles, n, idx, value);
+      if (next == idx)
+        break;
+      idx = next;
+    }
+    allReached = allReached && value(idx) == 0.f;
+  }
+  return allReached;
+}
+
+// every tile that reaches a source has a value and, unless it's a source, a lower neighbour
+static bool descends_to_sources(const std::vector<char> &tiles, size_t n, const std::vector<float> &map,
+                                const std::vector<float> &ref)
+{
+  for (size_t i = 0; i < map.size(); ++i)
+  {
+    if (ref[i] >= dmaps::invalid_tile_value)
+      continue;
+    if (map[i] >= dmaps::invalid_tile_value || (ref[i] == 0.f) != (map[i] == 0.f))
+      return false;
+    bool lower = map[i] == 0.f;
+    RowSearch::for_each_neighbour(tiles.data(), n, int(i % n), int(i / n), 0, 0, int(n), int(n),
+                                  [&](size_t nidx, int, int, float) { lower = lower || map[nidx] < map[i]; });
+    if (!lower)
+      return false;
+  }
+  return true;
+}
+
+static void bench_map(const std::string &gen, const std::vector<char> &tiles, size_t n, size_t numSources,
+                      const Options &opt, rng::Rng &rng, std::vector<Result> &results)
+{
+  std::vector<size_t> floor;
+  for (size_t i = 0; i < tiles.size(); ++i)
+    if (tiles[i] != dungeon::wall)
+      floor.push_back(i);
+  if (floor.empty())
+    return;
+  std::vector<size_t> sources;
+  for (size_t i = 0; i < numSources; ++i)
+    sources.push_back(floor[rng.index(floor.size())]);
+  std::sort(sources.begin(), sources.end());
+  sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
+
+  auto add = [&](const char *variant) -> Result &
+  {
+    results.push_back(Result{gen, n, numSources, variant, 0, 0.0, 0.0, -1});
+    return results.back();
+  };
+
+  const std::vector<float> ref = scan_reference(tiles, n, sources, add("scan"));
+
+  std::vector<float> map;
+  grid::BucketQueue queue;
+  Result &bucket = add("bucket");
+  time_runs(opt.repeats, bucket, [&]()
+  {
+    map = seeded_map(tiles.size(), sources);
+    RowSearch::bucket_dmap(map.data(), tiles.data(), n, n, dmaps::invalid_tile_value, queue);
+  });
+  bucket.exact = same_bits(map, ref);
+
+  // conversions in and out of the tiled layout aren't timed, the game keeps maps tiled
+  std::vector<char> tiledTiles;
+  grid::to_layout<grid::Tiled8>(tiles.data(), n, n, dungeon::wall, tiledTiles);
+  std::vector<size_t> tiledSources;
+  for (size_t idx : sources)
+    tiledSources.push_back(grid::Tiled8::index(int(idx % n), int(idx / n), n));
+  Result &tiled = add("bucket_tiled8");
+  time_runs(opt.repeats, tiled, [&]()
+  {
+    map = seeded_map(tiledTiles.size(), tiledSources);
+    TiledSearch::bucket_dmap(map.data(), tiledTiles.data(), n, n, dmaps::invalid_tile_value, queue);
+  });
+  std::vector<float> rowMajor(tiles.size());
+  for (size_t i = 0; i < rowMajor.size(); ++i)
+    rowMajor[i] = map[grid::Tiled8::index(int(i % n), int(i / n), n)];
+  tiled.exact = same_bits(rowMajor, ref);
+
+  dmaps::DmapField<RowSearch> field;
+  Result &full = add("field_rebuild");
+  time_runs(opt.repeats, full, [&]()
+  {
+    field = dmaps::DmapField<RowSearch>();
+    field.bind(tiles.data(), n, n);
+    field.set_point_seeds(sources, 0.f);
+    field.update();
+  });
+  full.exact = same_bits(field.values(), ref);
+
+  // one step of every source per run, checked after the last one
+  std::vector<size_t> moved = sources;
+  Result &incremental = add("field_incremental");
+  time_runs(opt.repeats, incremental, [&]()
+  {
+    moved = move_sources(tiles, n, moved, rng);
+    field.set_point_seeds(moved, 0.f);
+    field.update();
+  });
+  Result movedScan{};
+  incremental.exact = same_bits(field.values(), scan_reference(tiles, n, moved, movedScan));
+
+  // one of the sources takes a step per run, the others stay, what incremental updates are for
+  std::vector<size_t> oneMoved = sources;
+  dmaps::DmapField<RowSearch> oneField;
+  oneField.bind(tiles.data(), n, n);
+  oneField.set_point_seeds(oneMoved, 0.f);
+  oneField.update();
+  size_t turn = 0;
+  Result &moveOne = add("field_move_one");
+  time_runs(opt.repeats, moveOne, [&]()
+  {
+    size_t &src = oneMoved[turn++ % oneMoved.size()];
+    src = move_sources(tiles, n, {src}, rng).front();
+    oneField.set_point_seeds(oneMoved, 0.f);
+    oneField.update();
+  });
+  Result oneMovedScan{};
+  moveOne.exact = same_bits(oneField.values(), scan_reference(tiles, n, oneMoved, oneMovedScan));
+
+  // the flee map seeds every reachable tile with -1.2 times its approach value, negative and
+  // fractional seeds everywhere instead of a few zeros, the field is reseeded from the tiles the
+  // approach field changed each turn, the way gen_player_flee_map does it
+  auto flee_seeds = [](const std::vector<float> &approach)
+  {
+    std::vector<float> res(approach.size(), dmaps::invalid_tile_value);
+    for (size_t i = 0; i < approach.size(); ++i)
+      if (approach[i] < dmaps::invalid_tile_value)
+        res[i] = approach[i] * -1.2f;
+    return res;
+  };
+  const std::vector<float> fleeSeeds = flee_seeds(ref);
+  std::vector<float> fleeRef;
+  time_runs(1, add("flee_scan"), [&]()
+  {
+    fleeRef = fleeSeeds;
+    RowSearch::scan_dmap(fleeRef.data(), tiles.data(), n, n);
+  });
+  Result &fleeBucket = add("flee_bucket");
+  time_runs(opt.repeats, fleeBucket, [&]()
+  {
+    map = fleeSeeds;
+    RowSearch::bucket_dmap(map.data(), tiles.data(), n, n, dmaps::invalid_tile_value, queue);
+  });
+  fleeBucket.exact = same_bits(map, fleeRef);
+
+  dmaps::DmapField<RowSearch> approachField;
+  dmaps::DmapField<RowSearch> fleeField;
+  approachField.bind(tiles.data(), n, n);
+  fleeField.bind(tiles.data(), n, n);
+  size_t approachVersion = 0;
+  auto update_flee = [&]()
+  {
+    const std::vector<float> &approach = approachField.values();
+    auto reseed = [&](size_t i)
+    {
+      fleeField.set_seed(i, approach[i] < dmaps::invalid_tile_value ? approach[i] * -1.2f : dmaps::invalid_tile_value);
+    };
+    if (approachField.version() == approachVersion + 1)
+      for (size_t i : approachField.changed())
+        reseed(i);
+    else if (approachField.version() != approachVersion)
+      for (size_t i = 0; i < approach.size(); ++i)
+        reseed(i);
+    approachVersion = approachField.version();
+    fleeField.update();
+  };
+  std::vector<size_t> fleeSources = sources;
+  approachField.set_point_seeds(fleeSources, 0.f);
+  approachField.update();
+  update_flee();
+  bool fleeExact = same_bits(fleeField.values(), fleeRef);
+  // a run is a turn, the sources move, approach is updated and flee follows it
+  Result &fleeIncremental = add("flee_incremental");
+  time_runs(opt.repeats, fleeIncremental, [&]()
+  {
+    fleeSources = move_sources(tiles, n, fleeSources, rng);
+    approachField.set_point_seeds(fleeSources, 0.f);
+    approachField.update();
+    update_flee();
+  });
+  Result fleeMovedScan{};
+  std::vector<float> fleeMovedRef = flee_seeds(scan_reference(tiles, n, fleeSources, fleeMovedScan));
+  RowSearch::scan_dmap(fleeMovedRef.data(), tiles.data(), n, n);
+  fleeIncremental.exact = fleeExact && same_bits(fleeField.values(), fleeMovedRef);
+
+  dmaps::LazyDmapField<RowSearch> lazy;
+  lazy.bind(tiles.data(), n, n);
+  map.resize(tiles.size());
+  Result &lazyFull = add("lazy_full");
+  time_runs(opt.repeats, lazyFull, [&]()
+  {
+    lazy.reset(sources, 0.f);
+    for (size_t i = 0; i < map.size(); ++i)
+      map[i] = lazy.value(i);
+  });
+  lazyFull.exact = same_bits(map, ref);
+
+  // followers start anywhere a source can be reached from, a run is a turn of the game: the map
+  // is reset around the sources and every follower takes a step, far ones make the lazy field
+  // search most of the map every turn, that's what the pyramid is for
+  std::vector<size_t> startFollowers;
+  for (size_t i = 0; i < opt.followers; ++i)
+  {
+    const size_t idx = floor[rng.index(floor.size())];
+    if (ref[idx] < dmaps::invalid_tile_value)
+      startFollowers.push_back(idx);
+  }
+  auto lazyValue = [&](size_t idx) { return lazy.value(idx); };
+  std::vector<size_t> followers = startFollowers;
+  Result &lazyTurn = add("lazy_turn");
+  time_runs(opt.repeats, lazyTurn, [&]()
+  {
+    lazy.reset(sources, 0.f);
+    for (size_t &idx : followers)
+      idx = step_down(tiles, n, idx, lazyValue);
+  });
+  lazyTurn.exact = walk_followers(tiles, n, followers, lazyValue);
+
+  dmaps::DmapPyramid<RowSearch> pyramid;
+  pyramid.bind(tiles.data(), n, n);
+  auto pyramidValue = [&](size_t idx) { return pyramid.value(idx); };
+  followers = startFollowers;
+  Result &pyramidTurn = add("pyramid_turn");
+  time_runs(opt.repeats, pyramidTurn, [&]()
+  {
+    pyramid.reset(sources);
+    for (size_t &idx : followers)
+      idx = step_down(tiles, n, idx, pyramidValue);
+  });
+  pyramidTurn.exact = walk_followers(tiles, n, followers, pyramidValue);
+
+  Result &pyramidFull = add("pyramid_full");
+  time_runs(opt.repeats, pyramidFull, [&]()
+  {
+    pyramid.reset(sources);
+    for (size_t i = 0; i < map.size(); ++i)
+      map[i] = pyramid.value(i);
+  });
+  pyramidFull.exact = descends_to_sources(tiles, n, map, ref);
+}
+
+struct PathQuery
+{
+  IVec2 from;
+  IVec2 to;
+  IVec2 limMin;
+  IVec2 limMax;
+};
+
+// times one search over all queries per run, exact if every path has the length of the reference
+template<typename Callable>
+static void bench_queries(const std::vector<PathQuery> &queries, const std::vector<size_t> &lengths, size_t repeats,
+                          Result &res, Callable find)
+{
+  std::vector<size_t> found(queries.size());
+  time_runs(repeats, res, [&]()
+  {
+    for (size_t i = 0; i < queries.size(); ++i)
+      found[i] = find(queries[i]).size();
+  });
+  res.exact = found == lengths;
+}
+
+// whole map A* and IDA* as pathfinding/ calls them and A* inside the 10x10 tiles of the w7 portal
+// prebuild, old code first, the old A* scans its lists so the whole map ones only run on small maps
+static void bench_paths(const std::string &gen, const std::vector<char> &tiles, size_t n, const Options &opt,
+                        rng::Rng &rng, std::vector<Result> &results)
+{
+  std::vector<size_t> floor;
+  for (size_t i = 0; i < tiles.size(); ++i)
+    if (tiles[i] != dungeon::wall)
+      floor.push_back(i);
+  if (floor.empty() || opt.queries == 0)
+    return;
+  auto pos = [&](size_t idx) { return IVec2{int(idx % n), int(idx / n)}; };
+  auto add = [&](const char *variant) -> Result &
+  {
+    results.push_back(Result{gen, n, opt.queries, variant, 0, 0.0, 0.0, -1});
+    return results.back();
+  };
+  const IVec2 mapMax{int(n), int(n)};
+
+  constexpr int splitTiles = 10;
+  std::vector<PathQuery> portalQueries;
+  for (size_t tries = 0; portalQueries.size() < opt.queries && tries < opt.queries * 1000; ++tries)
+  {
+    const IVec2 from = pos(floor[rng.index(floor.size())]);
+    const IVec2 limMin{from.x - from.x % splitTiles, from.y - from.y % splitTiles};
+    const IVec2 limMax{std::min(limMin.x + splitTiles, mapMax.x), std::min(limMin.y + splitTiles, mapMax.y)};
+    const IVec2 to{limMin.x + int(rng.index(size_t(limMax.x - limMin.x))),
+                   limMin.y + int(rng.index(size_t(limMax.y - limMin.y)))};
+    if (tiles[legacy::coord_to_idx(to.x, to.y, n)] != dungeon::wall)
+      portalQueries.push_back({from, to, limMin, limMax});
+  }
+  std::vector<size_t> portalLengths;
+  for (const PathQuery &q : portalQueries)
+    portalLengths.push_back(PortalSearch::find_path(tiles.data(), n, n, q.from, q.to, q.limMin, q.limMax).size());
+  bench_queries(portalQueries, portalLengths, opt.repeats, add("portal_astar_legacy"), [&](const PathQuery &q)
+    { return legacy::find_path_a_star(tiles.data(), n, n, q.from, q.to, q.limMin, q.limMax); });
+  bench_queries(portalQueries, portalLengths, opt.repeats, add("portal_astar"), [&](const PathQuery &q)
+    { return PortalSearch::find_path(tiles.data(), n, n, q.from, q.to, q.limMin, q.limMax); });
+
+  if (n > 256)
+    return;
+  // only pairs with a path, the old A* takes seconds to give up on a big cave
+  std::vector<PathQuery> navQueries;
+  std::vector<PathQuery> idaQueries;
+  std::vector<float> map;
+  grid::BucketQueue queue;
+  for (size_t tries = 0; (navQueries.size() < opt.queries || idaQueries.size() < opt.queries) &&
+                         tries < opt.queries * 1000; ++tries)
+  {
+    const size_t fromIdx = floor[rng.index(floor.size())];
+    map = seeded_map(tiles.size(), {fromIdx});
+    RowSearch::bucket_dmap(map.data(), tiles.data(), n, n, dmaps::invalid_tile_value, queue);
+    const size_t toIdx = floor[rng.index(floor.size())];
+    if (navQueries.size() < opt.queries && map[toIdx] < dmaps::invalid_tile_value)
+      navQueries.push_back({pos(fromIdx), pos(toIdx), IVec2{0, 0}, mapMax});
+    // IDA* only keeps the path it's on, it's hopeless beyond a few steps
+    std::vector<size_t> near;
+    for (size_t idx : floor)
+      if (map[idx] > 0.f && map[idx] <= 8.f)
+        near.push_back(idx);
+    if (idaQueries.size() < opt.queries && !near.empty())
+      idaQueries.push_back({pos(fromIdx), pos(near[rng.index(near.size())]), IVec2{0, 0}, mapMax});
+  }
+
+  std::vector<size_t> navLengths;
+  for (const PathQuery &q : navQueries)
+    navLengths.push_back(NavSearch::find_path(tiles.data(), n, n, q.from, q.to).size());
+  bench_queries(navQueries, navLengths, opt.repeats, add("astar_legacy"), [&](const PathQuery &q)
+    { return legacy::find_path_a_star(tiles.data(), n, n, q.from, q.to, q.limMin, q.limMax); });
+  bench_queries(navQueries, navLengths, opt.repeats, add("astar"), [&](const PathQuery &q)
+    { return NavSearch::find_path(tiles.data(), n, n, q.from, q.to); });
+
+  std::vector<size_t> idaLengths;
+  for (const PathQuery &q : idaQueries)
+    idaLengths.push_back(NavSearch::find_path(tiles.data(), n, n, q.from, q.to).size());
+  bench_queries(idaQueries, idaLengths, opt.repeats, add("ida_legacy"), [&](const PathQuery &q)
+    { return legacy::find_ida_star_path(tiles.data(), n, n, q.from, q.to); });
+  bench_queries(idaQueries, idaLengths, opt.repeats, add("ida"), [&](const PathQuery &q)
+    { return NavSearch::find_path_ida(tiles.data(), n, n, q.from, q.to); });
+}
+
+static void print_csv(const std::vector<Result> &results)
+{
+  printf("generator,size,sources,variant,repeats,min_ms,median_ms,exact\n");
+  for (const Result &r : results)
+    printf("%s,%zu,%zu,%s,%zu,%.3f,%.3f,%s\n", r.gen.c_str(), r.size, r.sources, r.variant.c_str(), r.repeats,
+           r.minMs, r.medianMs, r.exact < 0 ? "" : r.exact ? "true" : "false");
+}
+
+static void print_json(const std::vector<Result> &results, unsigned seed)
+{
+  printf("{\n  \"seed\": %u,\n  \"results\": [", seed);
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    const Result &r = results[i];
+    printf("%s\n    {\"generator\": \"%s\", \"size\": %zu, \"sources\": %zu, \"variant\": \"%s\", \"repeats\": %zu, "
+           "\"min_ms\": %.3f, \"median_ms\": %.3f, \"exact\": %s}", i ? "," : "", r.gen.c_str(), r.size, r.sources,
+           r.variant.c_str(), r.repeats, r.minMs, r.medianMs, r.exact < 0 ? "null" : r.exact ? "true" : "false");
+  }
+  printf("\n  ]\n}\n");
+}
+
+int main(int argc, const char **argv)
+{
+  Options opt;
+  if (!parse_options(argc, argv, opt))
+    return 2;
+  rng::Rng rng(opt.seed);
+  std::vector<Result> results;
+  for (const Generator &gen : generators)
+  {
+    if (!opt.gens.empty() && std::find(opt.gens.begin(), opt.gens.end(), gen.name) == opt.gens.end())
+      continue;
+    for (size_t n : opt.sizes)
+    {
+      if (n > gen.maxSize || n < 8)
+        continue;
+      std::vector<char> tiles(n * n);
+      Result &generate = results.emplace_back(Result{gen.name, n, 0, "generate", 0, 0.0, 0.0, -1});
+      time_runs(1, generate, [&]() { gen.gen(tiles.data(), n, rng); });
+      for (size_t numSources : opt.sources)
+      {
+        fprintf(stderr, "%s %zux%zu, %zu sources\n", gen.name, n, n, numSources);
+        bench_map(gen.name, tiles, n, numSources, opt, rng, results);
+      }
+      fprintf(stderr, "%s %zux%zu, %zu path queries\n", gen.name, n, n, opt.queries);
+      bench_paths(gen.name, tiles, n, opt, rng, results);
+    }
+  }
+  if (opt.json)
+    print_json(results, opt.seed);
+  else
+    print_csv(results);
+  // exit code catches regressions in scripts
+  for (const Result &r : results)
+    if (r.exact == 0)
+      return 1;
+  return 0;
+}
@@ -4,6 +4,7 @@
 #include "raylib.h"
 #include "math.h"
 #include "aiUtils.h"
+#include "rng.h"
 
 class AttackEnemyState : public State
 {
@@ -51,14 +52,14 @@ public:
   void exit() const override {}
   void act(float/* dt*/, flecs::world &, flecs::entity entity) const override
   {
-    entity.set([&](const Position &pos, const PatrolPos &ppos, Action &a)
+    entity.set([&](const Position &pos, const PatrolPos &ppos, Action &a, rng::Rng &rng)
     {
       if (dist(pos, ppos) > patrolDist)
         a.action = move_towards(pos, ppos); // do a recovery walk
       else
       {
         // do a random walk
-        a.action = GetRandomValue(EA_MOVE_START, EA_MOVE_END - 1);
+        a.action = rng.range(EA_MOVE_START, EA_MOVE_END - 1);
       }
     });
   }
@@ -4,6 +4,7 @@
 #include "math.h"
 #include "raylib.h"
 #include "blackboard.h"
+#include "rng.h"
 #include <algorithm>
 
 struct CompoundNode : public BehNode
@@ -213,13 +214,13 @@ struct Patrol : public BehNode
   BehResult update(flecs::world &, flecs::entity entity, Blackboard &bb) override
   {
     BehResult res = BEH_RUNNING;
-    entity.set([&](Action &a, const Position &pos)
+    entity.set([&](Action &a, const Position &pos, rng::Rng &rng)
     {
       Position patrolPos = bb.get<Position>(pposBb);
       if (dist(pos, patrolPos) > patrolDist)
         a.action = move_towards(pos, patrolPos);
       else
-        a.action = GetRandomValue(EA_MOVE_START, EA_MOVE_END - 1); // do a random walk
+        a.action = rng.range(EA_MOVE_START, EA_MOVE_END - 1); // do a random walk
     });
     return res;
   }
@@ -1,7 +1,13 @@
 #include "dijkstraMapGen.h"
 #include "ecsTypes.h"
 #include "dungeonUtils.h"
+#include "dmapField.h"
+#include "dmapPyramid.h"
+#include "jobGraph.h"
+#include "dmapStorage.h"
+#include "fov.h"
 #include "math.h"
+#include <unordered_map>
 
 template<typename Callable>
 static void query_dungeon_data(flecs::world &ecs, Callable c)
@@ -19,183 +25,337 @@ static void query_characters_positions(flecs::world &ecs, Callable c)
   characterPositionQuery.each(c);
 }
 
-constexpr float invalid_tile_value = 1e5f;
+using DmapSearch = grid::GridSearch<grid::Neighbourhood4, grid::UniformCost<dungeon::wall>, grid::Manhattan, dmaps::Layout>;
+using SearchField = dmaps::DmapField<DmapSearch>;
+using LazySearchField = dmaps::LazyDmapField<DmapSearch>;
+using PyramidSearchField = dmaps::DmapPyramid<DmapSearch>;
 
-static void init_tiles(std::vector<float> &map, const DungeonData &dd)
-{
-  map.resize(dd.width * dd.height);
-  for (float &v : map)
-    v = invalid_tile_value;
-}
+// fields keep their distances between turns and only repair what their seeds changed
+static SearchField approachField;
+static SearchField fleeField;
+static SearchField hiveField;
+static SearchField magicianField;
+static SearchField exploreField;
+static SearchField teammateField;
 
-// scan version, could be implemented as Dijkstra version as well
-static void process_dmap(std::vector<float> &map, const DungeonData &dd)
+// everything map jobs need from the world, gathered on the main thread before they start
+struct DmapInputs
 {
-  bool done = false;
-  auto getMapAt = [&](size_t x, size_t y, float def)
-  {
-    if (x < dd.width && y < dd.width && dd.tiles[y * dd.width + x] == dungeon::floor)
-      return map[y * dd.width + x];
-    return def;
-  };
-  auto getMinNei = [&](size_t x, size_t y)
-  {
-    float val = map[y * dd.width + x];
-    val = std::min(val, getMapAt(x - 1, y + 0, val));
-    val = std::min(val, getMapAt(x + 1, y + 0, val));
-    val = std::min(val, getMapAt(x + 0, y - 1, val));
-    val = std::min(val, getMapAt(x + 0, y + 1, val));
-    return val;
-  };
-  while (!done)
+  const DungeonData *dd = nullptr;
+  const char *tiles = nullptr; // dd->tiles in dmaps::Layout order
+  std::vector<Position> players;
+  std::vector<size_t> playerSeeds;
+  std::vector<size_t> hiveSeeds;
+  std::vector<size_t> exploreSeeds;
+  std::vector<size_t> teammateSeeds;
+  std::vector<size_t> magicianSeeds;
+
+  void clear()
   {
-    done = true;
-    for (size_t y = 0; y < dd.height; ++y)
-      for (size_t x = 0; x < dd.width; ++x)
-      {
-        const size_t i = y * dd.width + x;
-        if (dd.tiles[i] != dungeon::floor)
-          continue;
-        const float myVal = getMapAt(x, y, invalid_tile_value);
-        const float minVal = getMinNei(x, y);
-        if (minVal < myVal - 1.f)
-        {
-          map[i] = minVal + 1.f;
-          done = false;
-        }
-      }
+    players.clear();
+    playerSeeds.clear();
+    hiveSeeds.clear();
+    exploreSeeds.clear();
+    teammateSeeds.clear();
+    magicianSeeds.clear();
   }
-}
+};
 
-void dmaps::gen_player_approach_map(flecs::world &ecs, std::vector<float> &map)
+static void bind_field(SearchField &field, const DmapInputs &in)
 {
-  query_dungeon_data(ecs, [&](const DungeonData &dd)
-  {
-    init_tiles(map, dd);
-    query_characters_positions(ecs, [&](const Position &pos, const Team &t)
-    {
-      if (t.team == 0) // player team hardcode
-        map[pos.y * dd.width + pos.x] = 0.f;
-    });
-    process_dmap(map, dd);
-  });
+  field.bind(in.tiles, in.dd->width, in.dd->height);
 }
 
-void dmaps::gen_player_flee_map(flecs::world &ecs, std::vector<float> &map)
+static void update_point_field(SearchField &field, const DmapInputs &in, const std::vector<size_t> &seeds)
 {
-  gen_player_approach_map(ecs, map);
-  for (float &v : map)
-    if (v < invalid_tile_value)
-      v *= -1.2f;
-  query_dungeon_data(ecs, [&](const DungeonData &dd)
-  {
-    process_dmap(map, dd);
-  });
+  bind_field(field, in);
+  field.set_point_seeds(seeds, 0.f);
+  field.update();
 }
 
-void dmaps::gen_hive_pack_map(flecs::world &ecs, std::vector<float> &map)
+static void gen_player_flee_map(DmapInputs &in)
 {
-  static auto hiveQuery = ecs.query<const Position, const Hive>();
-  query_dungeon_data(ecs, [&](const DungeonData &dd)
+  static size_t approachVersion = 0;
+  const std::vector<float> &approachMap = approachField.values();
+  bind_field(fleeField, in);
+  auto reseed = [&](size_t i)
   {
-    init_tiles(map, dd);
-    hiveQuery.each([&](const Position &pos, const Hive &)
-    {
-      map[pos.y * dd.width + pos.x] = 0.f;
-    });
-    process_dmap(map, dd);
-  });
+    const float v = approachMap[i];
+    fleeField.set_seed(i, v < dmaps::invalid_tile_value ? v * -1.2f : dmaps::invalid_tile_value);
+  };
+  // only approach tiles that changed since we've seen it last time need new seeds
+  if (approachField.version() == approachVersion + 1)
+    for (size_t i : approachField.changed())
+      reseed(i);
+  else if (approachField.version() != approachVersion)
+    for (size_t i = 0; i < approachMap.size(); ++i)
+      reseed(i);
+  approachVersion = approachField.version();
+  fleeField.update();
 }
 
-void dmaps::gen_magician_map(flecs::world &ecs, std::vector<float> &map)
+static void gen_magician_map(DmapInputs &in)
 {
-  query_dungeon_data(ecs, [&](const DungeonData &dd)
+  const DungeonData &dd = *in.dd;
+  const std::vector<float> &temp_map = approachField.values();
+  std::vector<size_t> &seeds = in.magicianSeeds;
+  // only this job uses it, so it doesn't need to be shared between threads
+  static fov::FovCache fovCache;
+  for (const Position &pos : in.players)
   {
-    std::vector<float> temp_map;
-    gen_player_approach_map(ecs, temp_map);
-    init_tiles(map, dd);
-    query_characters_positions(ecs, [&](const Position &pos, const Team &t)
+    const fov::VisibilitySet &fov = fovCache.get(dd.tiles.data(), dd.width, dd.height, dungeon::wall, pos, 4);
+    for (int y = -4; y <= 4; ++y)
     {
-      if (t.team == 0)
+      for (int x = -4; x <= 4; ++x)
       {
-        for (int y = -4; y <= 4; ++y)
+        Position tile_pos = Position{pos.x + x, pos.y + y};
+        if (tile_pos.x < 0 || tile_pos.y < 0 || tile_pos.x >= int(dd.width) || tile_pos.y >= int(dd.height))
+          continue;
+        if (temp_map[dmaps::tile_index(tile_pos.x, tile_pos.y, dd.width)] == 4 && fov.visible(tile_pos))
+        {
+          seeds.push_back(dmaps::tile_index(tile_pos.x, tile_pos.y, dd.width));
+        }
+        else if (temp_map[dmaps::tile_index(tile_pos.x, tile_pos.y, dd.width)] == 4 && !fov.visible(tile_pos))
         {
-          for (int x = -4; x <= 4; ++x)
+          Position last_visible_tile = tile_pos;
+          while (!fov.visible(last_visible_tile) && last_visible_tile != pos)
           {
-            Position tile_pos = Position{pos.x + x, pos.y + y};
-            if (temp_map[tile_pos.y * dd.width + tile_pos.x] == 4 && dungeon::is_tile_visible(ecs, tile_pos, pos))
+            bool find_tile = false;
+            for (int k = -1; k <= 1; ++k)
             {
-              map[tile_pos.y * dd.width + tile_pos.x] = 0;
-            }
-            else if (temp_map[tile_pos.y * dd.width + tile_pos.x] == 4 && !dungeon::is_tile_visible(ecs, tile_pos, pos))
-            {
-              Position last_visible_tile = tile_pos;
-              while (!dungeon::is_tile_visible(ecs, last_visible_tile, pos) && last_visible_tile != pos)
+              for (int l = -1; l <= 1; ++l)
               {
-                bool find_tile = false;
-                for (int k = -1; k <= 1; ++k)
-                {
-                  for (int l = -1; l <= 1; ++l)
-                  {
-                    if (temp_map[(last_visible_tile.y + k) * dd.width + last_visible_tile.x + l] < temp_map[last_visible_tile.y * dd.width + last_visible_tile.x])
-                    { 
-                      last_visible_tile.x += l;
-                      last_visible_tile.y += k;
-                      find_tile = true;
-                      break;
-                    }
-                  }
-                  if (find_tile)
-                    break;
+                if (temp_map[dmaps::tile_index(last_visible_tile.x + l, last_visible_tile.y + k, dd.width)] <
+                    temp_map[dmaps::tile_index(last_visible_tile.x, last_visible_tile.y, dd.width)])
+                { 
+                  last_visible_tile.x += l;
+                  last_visible_tile.y += k;
+                  find_tile = true;
+                  break;
                 }
               }
-              map[last_visible_tile.y * dd.width + last_visible_tile.x] = 0;
+              if (find_tile)
+                break;
             }
           }
+          seeds.push_back(dmaps::tile_index(last_visible_tile.x, last_visible_tile.y, dd.width));
         }
       }
-    });
-    process_dmap(map, dd);
-  });
+    }
+  }
+  update_point_field(magicianField, in, seeds);
 }
 
-void dmaps::gen_explore_map(flecs::world &ecs, std::vector<float> &map)
+static void gather_inputs(flecs::world &ecs, const DungeonData &dd, unsigned kinds, DmapInputs &in)
 {
-  query_dungeon_data(ecs, [&](const DungeonData &dd)
+  // dungeon tiles don't change during a level, they are only reordered when it's a new one
+  static std::vector<char> layoutTiles;
+  static const char *layoutSource = nullptr;
+  if (layoutSource != dd.tiles.data())
   {
-    init_tiles(map, dd);
-    static auto playerQuery = ecs.query<const Position, const IsPlayer, NextExplorePos>();
-    playerQuery.each([&](const Position &pos, const IsPlayer &, NextExplorePos &nextPos)
+    layoutSource = dd.tiles.data();
+    grid::to_layout<dmaps::Layout>(dd.tiles.data(), dd.width, dd.height, dungeon::wall, layoutTiles);
+  }
+  in.dd = &dd;
+  in.tiles = layoutTiles.data();
+  in.clear();
+  if (kinds & (dmaps::DMAP_APPROACH | dmaps::DMAP_FLEE | dmaps::DMAP_MAGICIAN))
+  {
+    query_characters_positions(ecs, [&](const Position &pos, const Team &t)
     {
-      if (int(dist(pos, nextPos)) == 0 || (nextPos.x == -1 || nextPos.y == -1))
+      if (t.team == 0) // player team hardcode
       {
-        Position nex_tile = dungeon::find_neares_unexplore_tile(ecs, pos);
-        if (nex_tile.x >= 0 && nex_tile.x < int(dd.width) && nex_tile.y >= 0 && nex_tile.y < int(dd.height))
-        {
-          map[nex_tile.y * dd.width + nex_tile.x] = 0.f;
-          nextPos = NextExplorePos{nex_tile.x, nex_tile.y};
-        }
+        in.players.push_back(pos);
+        in.playerSeeds.push_back(dmaps::tile_index(pos.x, pos.y, dd.width));
       }
-      else
-      {
-        map[nextPos.y * dd.width + nextPos.x] = 0.f;
-      } 
     });
-    process_dmap(map, dd);
-  });
+  }
+  if (kinds & dmaps::DMAP_HIVE)
+  {
+    static auto hiveQuery = ecs.query<const Position, const Hive>();
+    hiveQuery.each([&](const Position &pos, const Hive &)
+    {
+      in.hiveSeeds.push_back(dmaps::tile_index(pos.x, pos.y, dd.width));
+    });
+  }
+  if (kinds & dmaps::DMAP_EXPLORE)
+  {
+    // every frontier tile is a goal, followers just walk down to the closest one
+    static auto frontierQuery = ecs.query<const ExploreFrontier>();
+    frontierQuery.each([&](const ExploreFrontier &frontier)
+    {
+      for (size_t idx : frontier.tiles)
+        in.exploreSeeds.push_back(dmaps::tile_index(int(idx % dd.width), int(idx / dd.width), dd.width));
+    });
+  }
+  if (kinds & dmaps::DMAP_TEAMMATE)
+  {
+    static auto teamQuery = ecs.query<const Position, const Team>();
+    teamQuery.each([&](flecs::entity e, const Position &pos, const Team &t)
+    {
+      if (t.team == 1 && !e.has<IsMag>())
+        in.teammateSeeds.push_back(dmaps::tile_index(pos.x, pos.y, dd.width));
+    });
+  }
+}
+
+static void gen_approach_map(DmapInputs &in) { update_point_field(approachField, in, in.playerSeeds); }
+static void gen_hive_map(DmapInputs &in) { update_point_field(hiveField, in, in.hiveSeeds); }
+static void gen_explore_map(DmapInputs &in) { update_point_field(exploreField, in, in.exploreSeeds); }
+static void gen_teammate_map(DmapInputs &in) { update_point_field(teammateField, in, in.teammateSeeds); }
+
+// every map the game knows about, maps are listed after the ones they are generated from
+struct DmapEntry
+{
+  unsigned kind;
+  const char *name;
+  const SearchField &field;
+  void (*generate)(DmapInputs &in);
+  unsigned deps; // kinds that have to be generated first
+  // point seeds of maps that can be searched lazily, nullptr for the ones built from other maps
+  const std::vector<size_t> DmapInputs::*seeds;
+  size_t consumers;
+  size_t storedVersion;
+  flecs::entity entity;
+  LazySearchField lazyField;
+  PyramidSearchField pyramid;
+};
+
+static DmapEntry registry[] = {
+  {dmaps::DMAP_EXPLORE, "explore_map", exploreField, gen_explore_map, 0, &DmapInputs::exploreSeeds, 0, 0, flecs::entity(), {}, {}},
+  {dmaps::DMAP_APPROACH, "approach_map", approachField, gen_approach_map, 0, &DmapInputs::playerSeeds, 0, 0, flecs::entity(), {}, {}},
+  {dmaps::DMAP_FLEE, "flee_map", fleeField, gen_player_flee_map, dmaps::DMAP_APPROACH, nullptr, 0, 0, flecs::entity(), {}, {}},
+  {dmaps::DMAP_HIVE, "hive_map", hiveField, gen_hive_map, 0, &DmapInputs::hiveSeeds, 0, 0, flecs::entity(), {}, {}},
+  {dmaps::DMAP_MAGICIAN, "magician_map", magicianField, gen_magician_map, dmaps::DMAP_APPROACH, nullptr, 0, 0, flecs::entity(), {}, {}},
+  {dmaps::DMAP_TEAMMATE, "teammate_map", teammateField, gen_teammate_map, 0, &DmapInputs::teammateSeeds, 0, 0, flecs::entity(), {}, {}}
+};
+constexpr size_t registry_size = sizeof(registry) / sizeof(registry[0]);
+
+// kinds every consumer was counted for last time, so a new set of weights can be diffed against it
+static std::unordered_map<flecs::entity_t, unsigned> consumerKinds;
+
+static void count_consumer(unsigned kinds, bool add)
+{
+  for (DmapEntry &entry : registry)
+    if (kinds & entry.kind)
+    {
+      if (add)
+        ++entry.consumers;
+      else
+        --entry.consumers;
+    }
+}
+
+void dmaps::set_consumer(flecs::entity e, const DmapWeights &wt)
+{
+  unsigned kinds = 0;
+  for (const auto &pair : wt.weights)
+    for (const DmapEntry &entry : registry)
+      if (pair.first == entry.name)
+        kinds |= entry.kind;
+  unsigned &counted = consumerKinds[e.id()];
+  count_consumer(counted, false);
+  count_consumer(kinds, true);
+  counted = kinds;
+}
+
+void dmaps::remove_consumer(flecs::entity e)
+{
+  auto it = consumerKinds.find(e.id());
+  if (it == consumerKinds.end())
+    return;
+  count_consumer(it->second, false);
+  consumerKinds.erase(it);
 }
 
-void dmaps::gen_teamamte_map(flecs::world &ecs, std::vector<float> &map)
+bool dmaps::gen_maps(flecs::world &ecs, unsigned kinds)
 {
+  // only maps somebody reads, plus whatever they are generated from, lazy maps just restart
+  // their search and are expanded by lookups later
+  unsigned consumed = 0;
+  unsigned lazy = 0;
+  for (DmapEntry &entry : registry)
+  {
+    if (!(kinds & entry.kind) || entry.consumers == 0)
+      continue;
+    if (!entry.entity.is_alive())
+    {
+      entry.entity = ecs.entity(entry.name);
+      entry.storedVersion = 0;
+    }
+    consumed |= entry.kind;
+    if (entry.seeds && entry.entity.has<LazyDmap>())
+      lazy |= entry.kind;
+  }
+  unsigned needed = consumed & ~lazy;
+  for (size_t i = registry_size; i > 0; --i)
+    if (needed & registry[i - 1].kind)
+      needed |= registry[i - 1].deps;
+  // other maps are built from it anyway, followers read the full one then
+  lazy &= ~needed;
+  if (!needed && !lazy)
+    return false;
+
+  // all of these keep their capacity, so steady state turns don't allocate
+  static ThreadPool pool;
+  static JobGraph graph;
+  static DmapInputs in;
+  bool stored = false;
   query_dungeon_data(ecs, [&](const DungeonData &dd)
   {
-    init_tiles(map, dd);
-    static auto playerQuery = ecs.query<const Position, const Team>();
-    playerQuery.each([&](flecs::entity e, const Position &pos, const Team &t)
+    gather_inputs(ecs, dd, needed | lazy, in);
+
+    // every job owns its field, the ones with deps only read fields of earlier jobs
+    graph.clear();
+    size_t jobs[registry_size];
+    for (size_t i = 0; i < registry_size; ++i)
     {
-      if (t.team == 1 && !e.has<IsMag>())
-        map[pos.y * dd.width + pos.x] = 0.f;
-    });
-    process_dmap(map, dd);
+      const DmapEntry &entry = registry[i];
+      if (!(needed & entry.kind))
+        continue;
+      jobs[i] = graph.add([&entry]() { entry.generate(in); });
+      for (size_t j = 0; j < i; ++j)
+        if (entry.deps & registry[j].kind)
+          graph.depend(jobs[i], jobs[j]);
+    }
+    graph.run(pool);
+
+    for (DmapEntry &entry : registry)
+    {
+      if (!(lazy & entry.kind))
+        continue;
+      const bool hasLazyData = entry.entity.has<LazyDijkstraMapData>();
+      if (entry.entity.has<PyramidDmap>())
+      {
+        PyramidSearchField &field = entry.pyramid;
+        field.bind(in.tiles, dd.width, dd.height);
+        field.reset(in.*entry.seeds);
+        if (!hasLazyData)
+          dmaps::store_lazy(entry.entity, [&field](size_t idx) { return field.value(idx); }, field.size());
+      }
+      else
+      {
+        LazySearchField &field = entry.lazyField;
+        field.bind(in.tiles, dd.width, dd.height);
+        field.reset(in.*entry.seeds, 0.f);
+        if (!hasLazyData)
+          dmaps::store_lazy(entry.entity, [&field](size_t idx) { return field.value(idx); }, field.size());
+      }
+      entry.storedVersion = 0;
+    }
+
+    // fields are the back buffers, components are only rewritten for maps that were asked for
+    // and actually changed since they were stored
+    for (DmapEntry &entry : registry)
+    {
+      if (!(consumed & needed & entry.kind))
+        continue;
+      if (entry.storedVersion == entry.field.version())
+        continue;
+      entry.storedVersion = entry.field.version();
+      dmaps::store(entry.entity, entry.field.values());
+      stored = true;
+    }
   });
-}
\ No newline at end of file
+  return stored;
+}
@@ -1,14 +1,26 @@
 #pragma once
 #include <vector>
 #include <flecs.h>
+#include "ecsTypes.h"
 
 namespace dmaps
 {
-  void gen_player_approach_map(flecs::world &ecs, std::vector<float> &map);
-  void gen_player_flee_map(flecs::world &ecs, std::vector<float> &map);
-  void gen_hive_pack_map(flecs::world &ecs, std::vector<float> &map);
-  void gen_magician_map(flecs::world &ecs, std::vector<float> &map);
-  void gen_explore_map(flecs::world &ecs, std::vector<float> &map);
-  void gen_teamamte_map(flecs::world &ecs, std::vector<float> &map);
-};
+  enum DmapKind
+  {
+    DMAP_EXPLORE = 1 << 0,
+    DMAP_APPROACH = 1 << 1,
+    DMAP_FLEE = 1 << 2,
+    DMAP_HIVE = 1 << 3,
+    DMAP_MAGICIAN = 1 << 4,
+    DMAP_TEAMMATE = 1 << 5
+  };
+
+  // maps referenced by nobody's DmapWeights are skipped, e's previous weights are replaced
+  void set_consumer(flecs::entity e, const DmapWeights &wt);
+  void remove_consumer(flecs::entity e);
 
+  // snapshots positions once, builds the requested maps (a mask of DmapKind) that have
+  // consumers concurrently and then commits them to their map entities in one go,
+  // false if no map component was rewritten
+  bool gen_maps(flecs::world &ecs, unsigned kinds);
+};
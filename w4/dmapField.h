@@ -0,0 +1,337 @@
+#pragma once
+#include <cstddef> // size_t
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "gridSearch.h"
+
+namespace dmaps
+{
+  constexpr float invalid_tile_value = 1e5f;
+
+  // Dijkstra map that keeps its distances between updates and only repairs
+  // the region affected by seed changes: seeds that got worse invalidate the
+  // tiles that were derived from them (increase wavefront), then everything
+  // that got better is relaxed from a bucket queue (decrease wavefront).
+  // Result is the same fixed point as a full Search::bucket_dmap run.
+  template<typename Search>
+  class DmapField
+  {
+  public:
+    // binds the field to a dungeon, rebinding to another one starts from scratch,
+    // tiles, seed indices and values are all in Search::Layout order
+    void bind(const char *tiles, size_t w, size_t h)
+    {
+      if (tiles == dungeonTiles && w == width && h == height)
+        return;
+      dungeonTiles = tiles;
+      width = w;
+      height = h;
+      const size_t count = Search::Layout::size(w, h);
+      dist.assign(count, invalid_tile_value);
+      seeds.assign(count, invalid_tile_value);
+      touched.assign(count, 0);
+      affected.assign(count, 0);
+      isPointSeed.assign(count, 0);
+      seedChanges.clear();
+      pointSeeds.clear();
+      changedTiles.clear();
+      ++updateVersion;
+    }
+
+    void set_seed(size_t idx, float value)
+    {
+      if (seeds[idx] == value)
+        return;
+      if (!touched[idx])
+      {
+        touched[idx] = 1;
+        seedChanges.emplace_back(idx, seeds[idx]);
+      }
+      seeds[idx] = value;
+    }
+
+    void clear_seed(size_t idx) { set_seed(idx, invalid_tile_value); }
+
+    // replaces a set of equally valued point seeds, only the difference is applied
+    void set_point_seeds(const std::vector<size_t> &indices, float value)
+    {
+      // marks instead of searching, so it's linear in the number of seeds
+      for (size_t idx : indices)
+        isPointSeed[idx] = 1;
+      for (size_t idx : pointSeeds)
+        if (!isPointSeed[idx])
+          clear_seed(idx);
+      for (size_t idx : indices)
+      {
+        isPointSeed[idx] = 0;
+        set_seed(idx, value);
+      }
+      pointSeeds = indices;
+    }
+
+    void update()
+    {
+      if (seedChanges.empty())
+        return;
+      ++updateVersion;
+      changedTiles.clear();
+      std::vector<size_t> &stack = scratch;
+      stack.clear();
+      // increase: collect every tile whose value could have come from a worse seed
+      for (const auto &[idx, oldSeed] : seedChanges)
+      {
+        touched[idx] = 0;
+        if (seeds[idx] > oldSeed && dist[idx] == oldSeed && !affected[idx])
+        {
+          affected[idx] = 1;
+          stack.push_back(idx);
+        }
+      }
+      const size_t rebuildThreshold = dist.size() / 4;
+      for (size_t i = 0; i < stack.size() && stack.size() <= rebuildThreshold; ++i)
+      {
+        const size_t idx = stack[i];
+        changedTiles.push_back(idx);
+        Search::for_each_neighbour(dungeonTiles, width, height, idx,
+          [&](size_t nidx, float len)
+          {
+            if (!affected[nidx] && dist[nidx] == dist[idx] + step(nidx, len))
+            {
+              affected[nidx] = 1;
+              stack.push_back(nidx);
+            }
+          });
+      }
+      // most of the map depends on what changed, starting over is cheaper
+      if (stack.size() > rebuildThreshold)
+      {
+        for (size_t idx : stack)
+          affected[idx] = 0;
+        rebuild_all();
+        return;
+      }
+      for (size_t idx : stack)
+        dist[idx] = seeds[idx];
+      // pull affected tiles back from the untouched boundary
+      pending.clear();
+      for (size_t idx : stack)
+      {
+        if (!passable(idx))
+          continue;
+        float best = dist[idx];
+        Search::for_each_neighbour(dungeonTiles, width, height, idx,
+          [&](size_t nidx, float len)
+          {
+            if (!affected[nidx])
+              best = std::min(best, dist[nidx] + step(idx, len));
+          });
+        dist[idx] = best;
+        if (best < invalid_tile_value)
+          pending.push_back(idx);
+      }
+      for (size_t idx : stack)
+        affected[idx] = 0;
+      // decrease: seeds that are better than what we have now
+      for (const auto &change : seedChanges)
+      {
+        const size_t idx = change.first;
+        if (seeds[idx] < dist[idx])
+        {
+          dist[idx] = seeds[idx];
+          changedTiles.push_back(idx);
+          // seeds on walls keep their value but don't spread, same as bucket_dmap
+          if (passable(idx))
+            pending.push_back(idx);
+        }
+      }
+      seedChanges.clear();
+      relax_pending();
+    }
+
+    // rebuilds everything from seeds
+    void rebuild()
+    {
+      ++updateVersion;
+      rebuild_all();
+    }
+
+    const std::vector<float> &values() const { return dist; }
+    // tiles that could have changed during the last update that had any seed changes,
+    // may contain duplicates
+    const std::vector<size_t> &changed() const { return changedTiles; }
+    // bumped by every update that had something to do
+    size_t version() const { return updateVersion; }
+
+  private:
+    float step(size_t to, float len) const { return len * Search::Cost::cost(dungeonTiles[to]); }
+    bool passable(size_t idx) const { return Search::Cost::passable(dungeonTiles[idx]); }
+
+    void rebuild_all()
+    {
+      for (const auto &change : seedChanges)
+        touched[change.first] = 0;
+      seedChanges.clear();
+      dist = seeds;
+      Search::bucket_dmap(dist.data(), dungeonTiles, width, height, invalid_tile_value, queue);
+      changedTiles.clear();
+      for (size_t i = 0; i < dist.size(); ++i)
+        changedTiles.push_back(i);
+    }
+
+    void relax_pending()
+    {
+      if (pending.empty())
+        return;
+      float base = dist[pending[0]];
+      for (size_t idx : pending)
+        base = std::min(base, dist[idx]);
+      queue.reset(base);
+      for (size_t idx : pending)
+        queue.push(dist[idx], idx);
+      queue.drain([&](size_t idx, float val)
+      {
+        if (dist[idx] != val)
+          return;
+        Search::for_each_neighbour(dungeonTiles, width, height, idx,
+          [&](size_t nidx, float len)
+          {
+            const float nval = val + step(nidx, len);
+            if (nval < dist[nidx])
+            {
+              dist[nidx] = nval;
+              queue.push(nval, nidx);
+              changedTiles.push_back(nidx);
+            }
+          });
+      });
+    }
+
+    const char *dungeonTiles = nullptr;
+    size_t width = 0;
+    size_t height = 0;
+    std::vector<float> dist;
+    std::vector<float> seeds;
+    std::vector<char> touched;
+    std::vector<char> affected;
+    std::vector<char> isPointSeed;
+    std::vector<std::pair<size_t, float>> seedChanges;
+    std::vector<size_t> pointSeeds;
+    std::vector<size_t> changedTiles;
+    std::vector<size_t> scratch;
+    std::vector<size_t> pending;
+    size_t updateVersion = 0;
+    grid::BucketQueue queue;
+  };
+
+  // Dijkstra map that is only expanded as far as lookups need it. The search from the seeds
+  // is paused between lookups and resumed until the asked tile is settled, so followers close
+  // to the seeds never pay for the rest of the map. Settled values are the same as bucket_dmap's.
+  template<typename Search>
+  class LazyDmapField
+  {
+  public:
+    // tiles and indices are in Search::Layout order, like DmapField
+    void bind(const char *tiles, size_t w, size_t h)
+    {
+      if (tiles == dungeonTiles && w == width && h == height)
+        return;
+      dungeonTiles = tiles;
+      width = w;
+      height = h;
+      const size_t count = Search::Layout::size(w, h);
+      dist.assign(count, invalid_tile_value);
+      seenIn.assign(count, 0);
+      settledIn.assign(count, 0);
+      search = 0;
+    }
+
+    // drops the previous search, only the seeds are touched so it doesn't depend on map size
+    void reset(const std::vector<size_t> &indices, float value)
+    {
+      if (++search == 0)
+      {
+        std::fill(seenIn.begin(), seenIn.end(), 0);
+        std::fill(settledIn.begin(), settledIn.end(), 0);
+        search = 1;
+      }
+      queue.reset(value);
+      for (size_t idx : indices)
+      {
+        dist[idx] = value;
+        seenIn[idx] = search;
+        // seeds on walls keep their value but don't spread, same as bucket_dmap
+        if (passable(idx))
+          queue.push(value, idx);
+        else
+          settledIn[idx] = search;
+      }
+    }
+
+    // settles every tile closer than limit, lookups below it don't expand anything after
+    void settle_below(float limit)
+    {
+      size_t popped;
+      float val;
+      while (queue.pop(popped, val))
+      {
+        if (val >= limit)
+        {
+          // same bucket or a later one, it's popped again on the next lookup
+          queue.push(val, popped);
+          return;
+        }
+        settle(popped, val);
+      }
+    }
+
+    bool settled(size_t idx) const { return settledIn[idx] == search; }
+
+    float value(size_t idx)
+    {
+      // walls are never reached, followers look at them all the time
+      if (!passable(idx))
+        return seenIn[idx] == search ? dist[idx] : invalid_tile_value;
+      size_t popped;
+      float val;
+      while (settledIn[idx] != search && queue.pop(popped, val))
+        settle(popped, val);
+      return seenIn[idx] == search ? dist[idx] : invalid_tile_value;
+    }
+
+    size_t size() const { return dist.size(); }
+
+  private:
+    bool passable(size_t idx) const { return Search::Cost::passable(dungeonTiles[idx]); }
+
+    void settle(size_t idx, float val)
+    {
+      if (settledIn[idx] == search || dist[idx] != val)
+        return;
+      // every step costs at least 1, nothing popped later can lower it
+      settledIn[idx] = search;
+      Search::for_each_neighbour(dungeonTiles, width, height, idx,
+        [&](size_t nidx, float len)
+        {
+          const float nval = val + len * Search::Cost::cost(dungeonTiles[nidx]);
+          if (seenIn[nidx] != search || nval < dist[nidx])
+          {
+            dist[nidx] = nval;
+            seenIn[nidx] = search;
+            queue.push(nval, nidx);
+          }
+        });
+    }
+
+    const char *dungeonTiles = nullptr;
+    size_t width = 0;
+    size_t height = 0;
+    std::vector<float> dist;
+    // tiles are valid for the search they were stamped with, older ones count as untouched
+    std::vector<uint32_t> seenIn;
+    std::vector<uint32_t> settledIn;
+    uint32_t search = 0;
+    grid::BucketQueue queue;
+  };
+};
@@ -1,10 +1,23 @@
 #include "ecsTypes.h"
 #include "dmapFollower.h"
+#include "dmapComposite.h"
 #include <cmath>
 
+// composite already has weights applied, it's just five loads
+static void add_composite(float *moveWeights, const std::vector<float> &composite, const DungeonData &dd, const Position &pos)
+{
+  if (composite.empty())
+    return;
+  moveWeights[EA_NOP]         += composite[dmaps::tile_index(pos.x+0, pos.y+0, dd.width)];
+  moveWeights[EA_MOVE_LEFT]   += composite[dmaps::tile_index(pos.x-1, pos.y+0, dd.width)];
+  moveWeights[EA_MOVE_RIGHT]  += composite[dmaps::tile_index(pos.x+1, pos.y+0, dd.width)];
+  moveWeights[EA_MOVE_UP]     += composite[dmaps::tile_index(pos.x+0, pos.y-1, dd.width)];
+  moveWeights[EA_MOVE_DOWN]   += composite[dmaps::tile_index(pos.x+0, pos.y+1, dd.width)];
+}
+
 void process_dmap_followers(flecs::world &ecs)
 {
-  static auto processDmapFollowers = ecs.query<const Position, Action, const DmapWeights>();
+  static auto processDmapFollowers = ecs.query<const Position, Action, const DmapWeights, CompiledDmapWeights>();
   static auto dungeonDataQuery = ecs.query<const DungeonData>();
   static auto playerQuery = ecs.query<const IsPlayer>();
 
@@ -14,16 +27,17 @@ void process_dmap_followers(flecs::world &ecs)
     entP = e;
   });
 
-  auto get_dmap_at = [&](const DijkstraMapData &dmap, const DungeonData &dd, size_t x, size_t y, float mult, float pow)
+  auto get_dmap_at = [&](const dmaps::DmapView &dmap, const DungeonData &dd, size_t x, size_t y, float mult, float pow)
   {
-    const float v = dmap.map[y * dd.width + x];
+    const float v = dmap.at(dmaps::tile_index(int(x), int(y), dd.width));
     if (v < 1e5f)
       return powf(v * mult, pow);
     return v;
   };
   dungeonDataQuery.each([&](const DungeonData &dd)
   {
-    processDmapFollowers.each([&](flecs::entity e, const Position &pos, Action &act, const DmapWeights &wt)
+    processDmapFollowers.each([&](flecs::entity e, const Position &pos, Action &act, const DmapWeights &wt,
+                                  CompiledDmapWeights &cw)
     {
       if (e == entP)
       {
@@ -32,20 +46,26 @@ void process_dmap_followers(flecs::world &ecs)
       float moveWeights[EA_MOVE_END];
       for (size_t i = 0; i < EA_MOVE_END; ++i)
         moveWeights[i] = 0.f;
-      for (const auto &pair : wt.weights)
+      if (!dmaps::is_resolved(cw))
+        dmaps::compile_weights(ecs, wt, cw);
+      add_composite(moveWeights, dmaps::get_composite(cw), dd, pos);
+      // only conditional weights and lazy maps are left to evaluate per follower
+      for (size_t i = 0; i < cw.count; ++i)
       {
-        if (!pair.second.usefunc(e))
+        const CompiledDmapWeights::Entry &entry = cw[i];
+        if (entry.usefunc ? !entry.usefunc(e) : !entry.lazy)
         {
           continue;
         }
-        ecs.entity(pair.first.c_str()).get([&](const DijkstraMapData &dmap)
+        dmaps::DmapView dmap;
+        if (dmaps::get_view(entry.map, dmap))
         {
-          moveWeights[EA_NOP]         += get_dmap_at(dmap, dd, pos.x+0, pos.y+0, pair.second.mult, pair.second.pow);
-          moveWeights[EA_MOVE_LEFT]   += get_dmap_at(dmap, dd, pos.x-1, pos.y+0, pair.second.mult, pair.second.pow);
-          moveWeights[EA_MOVE_RIGHT]  += get_dmap_at(dmap, dd, pos.x+1, pos.y+0, pair.second.mult, pair.second.pow);
-          moveWeights[EA_MOVE_UP]     += get_dmap_at(dmap, dd, pos.x+0, pos.y-1, pair.second.mult, pair.second.pow);
-          moveWeights[EA_MOVE_DOWN]   += get_dmap_at(dmap, dd, pos.x+0, pos.y+1, pair.second.mult, pair.second.pow);
-        });
+          moveWeights[EA_NOP]         += get_dmap_at(dmap, dd, pos.x+0, pos.y+0, entry.mult, entry.pow);
+          moveWeights[EA_MOVE_LEFT]   += get_dmap_at(dmap, dd, pos.x-1, pos.y+0, entry.mult, entry.pow);
+          moveWeights[EA_MOVE_RIGHT]  += get_dmap_at(dmap, dd, pos.x+1, pos.y+0, entry.mult, entry.pow);
+          moveWeights[EA_MOVE_UP]     += get_dmap_at(dmap, dd, pos.x+0, pos.y-1, entry.mult, entry.pow);
+          moveWeights[EA_MOVE_DOWN]   += get_dmap_at(dmap, dd, pos.x+0, pos.y+1, entry.mult, entry.pow);
+        }
       }
       float minWt = moveWeights[EA_NOP];
       for (size_t i = 0; i < EA_MOVE_END; ++i)
@@ -64,30 +84,40 @@ void next_player_auto_action(flecs::world &ecs)
   for (size_t i = 0; i < EA_MOVE_END; ++i)
     moveWeights[i] = 0.f;
   
-  auto get_dmap_at = [&](const DijkstraMapData &dmap, const DungeonData &dd, size_t x, size_t y, float mult, float pow)
+  auto get_dmap_at = [&](const dmaps::DmapView &dmap, const DungeonData &dd, size_t x, size_t y, float mult, float pow)
   {
-    const float v = dmap.map[y * dd.width + x];
+    const float v = dmap.at(dmaps::tile_index(int(x), int(y), dd.width));
     if (v < 1e5f)
       return powf(v * mult, pow);
     return v;
   };
 
-  static auto processDmapFollowers = ecs.query<const Position, Action, const DmapWeights, const IsPlayer>();
+  static auto processDmapFollowers = ecs.query<const Position, Action, const DmapWeights, CompiledDmapWeights, const IsPlayer>();
   static auto dungeonDataQuery = ecs.query<const DungeonData>();
   dungeonDataQuery.each([&](const DungeonData &dd)
   {
-    processDmapFollowers.each([&](const Position &pos, Action &act, const DmapWeights &wt, const IsPlayer &)
+    processDmapFollowers.each([&](const Position &pos, Action &act, const DmapWeights &wt, CompiledDmapWeights &cw,
+                                  const IsPlayer &)
     {
-      for (const auto &pair : wt.weights)
+      if (!dmaps::is_resolved(cw))
+        dmaps::compile_weights(ecs, wt, cw);
+      add_composite(moveWeights, dmaps::get_composite(cw), dd, pos);
+      for (size_t i = 0; i < cw.count; ++i)
       {
-        ecs.entity(pair.first.c_str()).get([&](const DijkstraMapData &dmap)
+        const CompiledDmapWeights::Entry &entry = cw[i];
+        if (!entry.usefunc && !entry.lazy)
         {
-          moveWeights[EA_NOP]         += get_dmap_at(dmap, dd, pos.x+0, pos.y+0, pair.second.mult, pair.second.pow);
-          moveWeights[EA_MOVE_LEFT]   += get_dmap_at(dmap, dd, pos.x-1, pos.y+0, pair.second.mult, pair.second.pow);
-          moveWeights[EA_MOVE_RIGHT]  += get_dmap_at(dmap, dd, pos.x+1, pos.y+0, pair.second.mult, pair.second.pow);
-          moveWeights[EA_MOVE_UP]     += get_dmap_at(dmap, dd, pos.x+0, pos.y-1, pair.second.mult, pair.second.pow);
-          moveWeights[EA_MOVE_DOWN]   += get_dmap_at(dmap, dd, pos.x+0, pos.y+1, pair.second.mult, pair.second.pow);
-        });
+          continue;
+        }
+        dmaps::DmapView dmap;
+        if (dmaps::get_view(entry.map, dmap))
+        {
+          moveWeights[EA_NOP]         += get_dmap_at(dmap, dd, pos.x+0, pos.y+0, entry.mult, entry.pow);
+          moveWeights[EA_MOVE_LEFT]   += get_dmap_at(dmap, dd, pos.x-1, pos.y+0, entry.mult, entry.pow);
+          moveWeights[EA_MOVE_RIGHT]  += get_dmap_at(dmap, dd, pos.x+1, pos.y+0, entry.mult, entry.pow);
+          moveWeights[EA_MOVE_UP]     += get_dmap_at(dmap, dd, pos.x+0, pos.y-1, entry.mult, entry.pow);
+          moveWeights[EA_MOVE_DOWN]   += get_dmap_at(dmap, dd, pos.x+0, pos.y+1, entry.mult, entry.pow);
+        }
       }
       act.action = EA_PASS;
       float minWt = moveWeights[EA_NOP];
@@ -0,0 +1,341 @@
+#pragma once
+#include <cstddef> // size_t
+#include <cstdint>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "dmapField.h"
+
+namespace dmaps
+{
+  // Lazy dmap with coarse levels for followers that are far from the seeds.
+  // Level blocks are 4x4 and 16x16 tiles (1/4 and 1/16 of the resolution), every connected
+  // part of a block is a region and regions of a level make a graph that is searched by hops.
+  // Tiles closer than nearDistance get exact distances from a LazyDmapField, tiles up to
+  // nearDistance hops away on the 4x4 level get hops * 4 plus a step inside their region,
+  // everything else reads the 16x16 level the same way. Each tier is offset above the one
+  // before it and a region only leads into regions one hop closer, so values always go down
+  // towards the seeds, far values are only roughly distances in tiles.
+  template<typename Search>
+  class DmapPyramid
+  {
+  public:
+    static constexpr size_t levels = 2;
+    static constexpr size_t step = 4;
+
+    // tiles and indices are in Search::Layout order
+    void bind(const char *tiles, size_t w, size_t h, float nearDistance = 16.f)
+    {
+      nearDist = nearDistance;
+      fine.bind(tiles, w, h);
+      if (tiles == dungeonTiles && w == width && h == height)
+        return;
+      dungeonTiles = tiles;
+      width = w;
+      height = h;
+      size_t shift = 0;
+      for (Level &level : coarse)
+      {
+        shift += 2; // step is 4
+        build_level(level, shift);
+      }
+      search = 0;
+    }
+
+    // point seeds with value 0
+    void reset(const std::vector<size_t> &indices)
+    {
+      if (++search == 0)
+      {
+        for (Level &level : coarse)
+        {
+          std::fill(level.hopsIn.begin(), level.hopsIn.end(), 0);
+          std::fill(level.localIn.begin(), level.localIn.end(), 0);
+        }
+        search = 1;
+      }
+      fine.reset(indices, 0.f);
+      fine.settle_below(nearDist);
+      float offset = nearDist;
+      for (size_t l = 0; l < levels; ++l)
+      {
+        Level &level = coarse[l];
+        level.offset = offset;
+        // last level covers everything, the others hand over after nearDistance hops
+        level.maxHops = l + 1 == levels ? uint32_t(-1) : uint32_t(nearDist);
+        search_hops(level, indices);
+        offset += nearDist * float(level.factor);
+      }
+    }
+
+    float value(size_t idx)
+    {
+      if (!Search::Cost::passable(dungeonTiles[idx]) || fine.settled(idx))
+        return fine.value(idx);
+      for (Level &level : coarse)
+      {
+        const uint32_t region = region_of(level, idx);
+        if (level.hopsIn[region] != search)
+          continue;
+        if (level.localIn[region] != search)
+        {
+          // steps inside a region only depend on which neighbours are one hop closer,
+          // far regions keep them while seeds move around
+          const uint64_t key = exit_key(level, region);
+          if (level.localIn[region] == 0 || level.hops[region] == 0 || key != level.localKey[region])
+            compute_local(level, region, idx);
+          level.localIn[region] = search;
+          level.localKey[region] = key;
+        }
+        return level.offset + float(level.hops[region] * level.factor) + level.local[idx];
+      }
+      return invalid_tile_value;
+    }
+
+    size_t size() const { return fine.size(); }
+
+  private:
+    static constexpr uint8_t no_region = 0xff;
+
+    struct Level
+    {
+      size_t factor = 1;
+      size_t shift = 0;
+      size_t blocksX = 0;
+      std::vector<uint8_t> localRegion; // per tile, which part of its block it's in
+      std::vector<uint32_t> firstRegion; // per block, regions of a block are numbered in a row
+      std::vector<uint32_t> edgeStart; // region graph, neighbours of r are edges[edgeStart[r]..edgeStart[r + 1])
+      std::vector<uint32_t> edges;
+      std::vector<uint32_t> hops;
+      std::vector<uint32_t> hopsIn;
+      std::vector<uint32_t> localIn;
+      std::vector<uint64_t> localKey;
+      std::vector<float> local; // per tile, step inside the region in [0, factor)
+      uint32_t maxHops = 0;
+      float offset = 0.f;
+    };
+
+    size_t block_of(const Level &level, int x, int y) const
+    {
+      return (size_t(y) >> level.shift) * level.blocksX + (size_t(x) >> level.shift);
+    }
+
+    uint32_t region_of(const Level &level, size_t idx, int x, int y) const
+    {
+      return level.firstRegion[block_of(level, x, y)] + level.localRegion[idx];
+    }
+
+    uint32_t region_of(const Level &level, size_t idx) const
+    {
+      return region_of(level, idx, Search::Layout::x_of(idx, width), Search::Layout::y_of(idx, width));
+    }
+
+    // calls c(idx, x, y) for every tile of the block
+    template<typename Callable>
+    void for_each_in_block(const Level &level, size_t block, Callable c) const
+    {
+      const size_t x0 = block % level.blocksX * level.factor;
+      const size_t y0 = block / level.blocksX * level.factor;
+      for (size_t y = y0; y < std::min(y0 + level.factor, height); ++y)
+        for (size_t x = x0; x < std::min(x0 + level.factor, width); ++x)
+          c(Search::Layout::index(int(x), int(y), width), int(x), int(y));
+    }
+
+    struct TileRef
+    {
+      size_t idx;
+      int x;
+      int y;
+    };
+
+    // calls c(TileRef) for neighbours of a tile inside the same block
+    template<typename Callable>
+    void for_each_block_neighbour(const Level &level, const TileRef &tile, Callable c) const
+    {
+      const int f = int(level.factor);
+      const int x0 = tile.x >> level.shift << level.shift;
+      const int y0 = tile.y >> level.shift << level.shift;
+      Search::for_each_neighbour(dungeonTiles, width, tile.x, tile.y, x0, y0, std::min(x0 + f, int(width)),
+                                 std::min(y0 + f, int(height)),
+                                 [&](size_t nidx, int nx, int ny, float) { c(TileRef{nidx, nx, ny}); });
+    }
+
+    void build_level(Level &level, size_t shift)
+    {
+      const size_t factor = size_t(1) << shift;
+      level.factor = factor;
+      level.shift = shift;
+      level.blocksX = (width + factor - 1) / factor;
+      const size_t numBlocks = level.blocksX * ((height + factor - 1) / factor);
+      level.localRegion.assign(Search::Layout::size(width, height), no_region);
+      level.firstRegion.assign(numBlocks, 0);
+      uint32_t numRegions = 0;
+      for (size_t block = 0; block < numBlocks; ++block)
+      {
+        level.firstRegion[block] = numRegions;
+        uint8_t parts = 0;
+        for_each_in_block(level, block, [&](size_t idx, int x, int y)
+        {
+          if (level.localRegion[idx] != no_region || !Search::Cost::passable(dungeonTiles[idx]))
+            return;
+          // 4x4 and 16x16 blocks can't have more parts than fit into a byte
+          level.localRegion[idx] = parts;
+          scratch.assign(1, TileRef{idx, x, y});
+          while (!scratch.empty())
+          {
+            const TileRef cur = scratch.back();
+            scratch.pop_back();
+            for_each_block_neighbour(level, cur, [&](const TileRef &next)
+            {
+              if (level.localRegion[next.idx] == no_region)
+              {
+                level.localRegion[next.idx] = parts;
+                scratch.push_back(next);
+              }
+            });
+          }
+          ++parts;
+        });
+        numRegions += parts;
+      }
+      // neighbouring regions are the ones a tile can step into across a block border
+      std::vector<std::pair<uint32_t, uint32_t>> links;
+      for (size_t y = 0; y < height; ++y)
+        for (size_t x = 0; x < width; ++x)
+        {
+          const size_t idx = Search::Layout::index(int(x), int(y), width);
+          if (level.localRegion[idx] == no_region)
+            continue;
+          const uint32_t region = region_of(level, idx, int(x), int(y));
+          Search::for_each_neighbour(dungeonTiles, width, int(x), int(y), 0, 0, int(width), int(height),
+            [&](size_t nidx, int nx, int ny, float)
+            {
+              const uint32_t nregion = region_of(level, nidx, nx, ny);
+              if (nregion != region)
+                links.emplace_back(region, nregion);
+            });
+        }
+      std::sort(links.begin(), links.end());
+      links.erase(std::unique(links.begin(), links.end()), links.end());
+      level.edgeStart.assign(numRegions + 1, 0);
+      level.edges.clear();
+      for (const auto &[from, to] : links)
+      {
+        ++level.edgeStart[from + 1];
+        level.edges.push_back(to);
+      }
+      for (size_t r = 0; r < numRegions; ++r)
+        level.edgeStart[r + 1] += level.edgeStart[r];
+      level.hops.assign(numRegions, 0);
+      level.hopsIn.assign(numRegions, 0);
+      level.localIn.assign(numRegions, 0);
+      level.localKey.assign(numRegions, 0);
+      level.local.assign(Search::Layout::size(width, height), 0.f);
+    }
+
+    // breadth first over regions from the ones with seeds, stops at maxHops
+    void search_hops(Level &level, const std::vector<size_t> &indices)
+    {
+      regionQueue.clear();
+      for (size_t idx : indices)
+      {
+        if (level.localRegion[idx] == no_region)
+          continue;
+        const uint32_t region = region_of(level, idx);
+        if (level.hopsIn[region] == search)
+          continue;
+        level.hopsIn[region] = search;
+        level.hops[region] = 0;
+        regionQueue.push_back(region);
+      }
+      for (size_t i = 0; i < regionQueue.size(); ++i)
+      {
+        const uint32_t region = regionQueue[i];
+        if (level.hops[region] + 1 >= level.maxHops)
+          continue;
+        for (uint32_t e = level.edgeStart[region]; e < level.edgeStart[region + 1]; ++e)
+        {
+          const uint32_t next = level.edges[e];
+          if (level.hopsIn[next] == search)
+            continue;
+          level.hopsIn[next] = search;
+          level.hops[next] = level.hops[region] + 1;
+          regionQueue.push_back(next);
+        }
+      }
+    }
+
+    uint64_t exit_key(const Level &level, uint32_t region) const
+    {
+      uint64_t key = 0;
+      for (uint32_t e = level.edgeStart[region]; e < level.edgeStart[region + 1]; ++e)
+      {
+        const uint32_t next = level.edges[e];
+        if (level.hopsIn[next] == search && level.hops[next] + 1 == level.hops[region])
+          key = key * 0x9e3779b97f4a7c15ull + next + 1;
+      }
+      return key;
+    }
+
+    // steps from every tile of the region to its exits into regions one hop closer, or to
+    // the seeds when the region has them, squeezed below one hop
+    void compute_local(Level &level, uint32_t region, size_t anyTile)
+    {
+      const uint32_t hops = level.hops[region];
+      const size_t block = block_of(level, Search::Layout::x_of(anyTile, width), Search::Layout::y_of(anyTile, width));
+      const uint8_t part = level.localRegion[anyTile];
+      scratch.clear();
+      const size_t edge = level.factor - 1;
+      for_each_in_block(level, block, [&](size_t idx, int x, int y)
+      {
+        if (level.localRegion[idx] != part)
+          return;
+        level.local[idx] = invalid_tile_value;
+        bool target = false;
+        if (hops == 0)
+          target = fine.settled(idx) && fine.value(idx) == 0.f;
+        else if ((size_t(x) & edge) == 0 || (size_t(x) & edge) == edge || (size_t(y) & edge) == 0 || (size_t(y) & edge) == edge)
+          // only tiles on the border of the block have other regions next to them
+          Search::for_each_neighbour(dungeonTiles, width, x, y, 0, 0, int(width), int(height),
+            [&](size_t nidx, int nx, int ny, float)
+            {
+              const uint32_t nregion = region_of(level, nidx, nx, ny);
+              target = target || (level.hopsIn[nregion] == search && level.hops[nregion] + 1 == hops);
+            });
+        if (target)
+        {
+          level.local[idx] = 0.f;
+          scratch.push_back(TileRef{idx, x, y});
+        }
+      });
+      float maxLocal = 0.f;
+      for (size_t i = 0; i < scratch.size(); ++i)
+      {
+        const TileRef cur = scratch[i];
+        const float next = level.local[cur.idx] + 1.f;
+        maxLocal = std::max(maxLocal, level.local[cur.idx]);
+        for_each_block_neighbour(level, cur, [&](const TileRef &n)
+        {
+          if (level.local[n.idx] > next)
+          {
+            level.local[n.idx] = next;
+            scratch.push_back(n);
+          }
+        });
+      }
+      const float scale = float(level.factor) / (maxLocal + 1.f);
+      for (const TileRef &tile : scratch)
+        level.local[tile.idx] *= scale;
+    }
+
+    const char *dungeonTiles = nullptr;
+    size_t width = 0;
+    size_t height = 0;
+    float nearDist = 16.f;
+    uint32_t search = 0;
+    LazyDmapField<Search> fine;
+    Level coarse[levels];
+    std::vector<TileRef> scratch;
+    std::vector<uint32_t> regionQueue;
+  };
+};
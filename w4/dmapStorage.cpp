@@ -0,0 +1,89 @@
+#include "dmapStorage.h"
+#include <cmath>
+#include <algorithm>
+
+constexpr float invalid_tile_value = 1e5f;
+
+void dmaps::quantize(const std::vector<float> &values, QuantizedDijkstraMapData &res)
+{
+  float minVal = invalid_tile_value;
+  float maxVal = -invalid_tile_value;
+  bool integral = true;
+  for (float v : values)
+  {
+    if (v >= invalid_tile_value)
+      continue;
+    minVal = std::min(minVal, v);
+    maxVal = std::max(maxVal, v);
+    integral = integral && v == std::floor(v);
+  }
+  res.map.resize(values.size());
+  if (minVal > maxVal)
+    minVal = maxVal = 0.f;
+  const float range = maxVal - minVal;
+  res.offset = minVal;
+  res.scale = integral && range < float(QuantizedDijkstraMapData::invalid) ? 1.f : range / float(QuantizedDijkstraMapData::invalid - 1);
+  if (res.scale == 0.f)
+    res.scale = 1.f;
+  const float invScale = 1.f / res.scale;
+  for (size_t i = 0; i < values.size(); ++i)
+  {
+    const long q = std::min(std::lround((values[i] - res.offset) * invScale), long(QuantizedDijkstraMapData::invalid - 1));
+    res.map[i] = values[i] < invalid_tile_value ? uint16_t(q) : QuantizedDijkstraMapData::invalid;
+  }
+}
+
+bool dmaps::get_view(flecs::entity map, DmapView &view)
+{
+  view = DmapView{};
+  map.get([&](const QuantizedDijkstraMapData &dmap)
+  {
+    view.quantized = dmap.map.data();
+    view.size = dmap.map.size();
+    view.scale = dmap.scale;
+    view.offset = dmap.offset;
+  });
+  if (view.quantized)
+    return true;
+  map.get([&](const LazyDijkstraMapData &dmap)
+  {
+    view.lazy = &dmap;
+    view.size = dmap.size;
+  });
+  if (view.lazy)
+    return true;
+  map.get([&](const DijkstraMapData &dmap)
+  {
+    view.values = dmap.map.data();
+    view.size = dmap.map.size();
+  });
+  return view.values != nullptr;
+}
+
+void dmaps::store(flecs::entity map, const std::vector<float> &values)
+{
+  map.remove<LazyDijkstraMapData>();
+  if (map.has<CompactDmap>())
+  {
+    map.remove<DijkstraMapData>();
+    map.set([&](QuantizedDijkstraMapData &dmap)
+    {
+      quantize(values, dmap);
+    });
+  }
+  else
+  {
+    map.remove<QuantizedDijkstraMapData>();
+    map.set([&](DijkstraMapData &dmap)
+    {
+      dmap.map.assign(values.begin(), values.end());
+    });
+  }
+}
+
+void dmaps::store_lazy(flecs::entity map, std::function<float(size_t)> at, size_t size)
+{
+  map.remove<DijkstraMapData>();
+  map.remove<QuantizedDijkstraMapData>();
+  map.set(LazyDijkstraMapData{std::move(at), size});
+}
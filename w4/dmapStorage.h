@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef> // size_t
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <flecs.h>
+#include "ecsTypes.h"
+#include "gridSearch.h"
+
+namespace dmaps
+{
+  // memory order of every generated map, tiled blocks only pay off from 4096x4096 on
+#ifdef DMAP_TILED_LAYOUT
+  using Layout = grid::Tiled8;
+#else
+  using Layout = grid::RowMajor;
+#endif
+
+  inline size_t tile_index(int x, int y, size_t w) { return Layout::index(x, y, w); }
+
+  // integer maps are stored exactly with scale 1, fractional ones (flee map) are spread over the
+  // full uint16 range, so the error is at most half of (max - min) / 65534
+  void quantize(const std::vector<float> &values, QuantizedDijkstraMapData &res);
+
+  // read-only access to whichever representation a map entity has
+  struct DmapView
+  {
+    const float *values = nullptr;
+    const uint16_t *quantized = nullptr;
+    const LazyDijkstraMapData *lazy = nullptr;
+    size_t size = 0;
+    float scale = 1.f;
+    float offset = 0.f;
+
+    float at(size_t idx) const
+    {
+      if (lazy)
+        return lazy->at(idx);
+      if (values)
+        return values[idx];
+      return quantized[idx] == QuantizedDijkstraMapData::invalid ? 1e5f : float(quantized[idx]) * scale + offset;
+    }
+  };
+
+  // false if the entity has no map yet
+  bool get_view(flecs::entity map, DmapView &view);
+  // writes values in place into the representation the map entity asks for
+  void store(flecs::entity map, const std::vector<float> &values);
+  // replaces whatever the map entity had with a map computed on lookup
+  void store_lazy(flecs::entity map, std::function<float(size_t)> at, size_t size);
+};
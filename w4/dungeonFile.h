@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef> // size_t
+#include <cstdint>
+#include <string>
+#include "tileBuffer.h"
+
+// Versioned binary dungeon files: a header with the size, seed and generator, then a tiles
+// layer and an optional explore layer. Layers are stored raw, one byte per tile, or as bits
+// when they only use two values. Raw layers are read straight from the mapped file.
+namespace mapfile
+{
+  constexpr uint32_t version = 1;
+
+  enum class Encoding : uint32_t
+  {
+    raw = 0,
+    bits = 1,
+  };
+
+  struct Info
+  {
+    size_t width = 0;
+    size_t height = 0;
+    uint64_t seed = 0;
+    std::string generator; // name and parameters in any form, up to 63 chars are kept
+  };
+
+  struct Dungeon
+  {
+    Info info;
+    TileBuffer tiles;
+    TileBuffer explore; // empty if the file has none
+  };
+
+  // explore can be null, fails if a bits layer has more than two values or the file can't be written
+  bool save(const char *path, const Info &info, const char *tiles, const char *explore, Encoding encoding);
+  // raw layers point into the mapping without a copy, it's unmapped with the last TileBuffer
+  bool load(const char *path, Dungeon &res);
+};
@@ -2,52 +2,146 @@
 #include "raylib.h"
 #include "math.h"
 
-Position dungeon::find_walkable_tile(flecs::world &ecs)
+void dungeon::init_walkable_index(const DungeonData &dd, WalkableIndex &index)
 {
-  static auto dungeonDataQuery = ecs.query<const DungeonData>();
+  index = WalkableIndex{};
+  for (size_t idx = 0; idx < dd.width * dd.height; ++idx)
+    if (dd.tiles[idx] == dungeon::floor)
+      index.tiles.push_back(uint32_t(idx));
+  index.occupied.assign((dd.width * dd.height + 63) / 64, 0);
+}
+
+Position dungeon::find_walkable_tile(flecs::world &ecs, rng::Rng &rng)
+{
+  static auto dungeonDataQuery = ecs.query<const DungeonData, const WalkableIndex>();
 
   Position res{0, 0};
-  dungeonDataQuery.each([&](const DungeonData &dd)
+  dungeonDataQuery.each([&](const DungeonData &dd, const WalkableIndex &index)
   {
-    // prebuild all walkable and get one of them
-    std::vector<Position> posList;
-    for (size_t y = 0; y < dd.height; ++y)
-      for (size_t x = 0; x < dd.width; ++x)
-        if (dd.tiles[y * dd.width + x] == dungeon::floor)
-          posList.push_back(Position{int(x), int(y)});
-    size_t rndIdx = size_t(GetRandomValue(0, int(posList.size()) - 1));
-    res = posList[rndIdx];
+    if (index.tiles.empty())
+      return;
+    const uint32_t idx = index.tiles[rng.index(index.tiles.size())];
+    res = Position{int(idx % dd.width), int(idx / dd.width)};
   });
   return res;
 }
 
-Position dungeon::find_neares_unexplore_tile(flecs::world &ecs, Position pos)
+static bool is_occupied(const WalkableIndex &index, uint32_t idx)
 {
-  static auto dungeonDataQuery = ecs.query<const DungeonData>();
+  return (index.occupied[idx / 64] >> (idx % 64)) & 1;
+}
 
-  Position res{-1, -1};
-  float closestDist = FLT_MAX;
-  dungeonDataQuery.each([&](const DungeonData &dd)
+static void occupy(WalkableIndex &index, uint32_t idx)
+{
+  if (is_occupied(index, idx))
+    return;
+  index.occupied[idx / 64] |= uint64_t(1) << (idx % 64);
+  index.occupiedTiles.push_back(idx);
+}
+
+Position dungeon::find_free_tile(flecs::world &ecs, rng::Rng &rng)
+{
+  static auto dungeonDataQuery = ecs.query<const DungeonData, WalkableIndex>();
+
+  Position res{0, 0};
+  dungeonDataQuery.each([&](const DungeonData &dd, WalkableIndex &index)
   {
-    for (size_t y = 0; y < dd.height; ++y)
+    if (index.tiles.empty())
+      return;
+    uint32_t idx = index.tiles[rng.index(index.tiles.size())];
+    // a few picks almost always find a free tile, the free ones are only listed for crowded dungeons
+    for (int attempt = 1; attempt < 16 && is_occupied(index, idx); ++attempt)
+      idx = index.tiles[rng.index(index.tiles.size())];
+    if (is_occupied(index, idx))
     {
-      for (size_t x = 0; x < dd.width; ++x)
-      {
-        if (dd.tilesExplore[y * dd.width + x] == dungeon::unexplored && dd.tiles[y * dd.width + x] == floor)
-        {
-          float dist_to_tile = dist(pos, Position{int(x), int(y)});
-          if (dist_to_tile < closestDist)
-          {
-            closestDist = dist_to_tile;
-            res = Position{int(x), int(y)};
-          }
-        }
-      }
+      std::vector<uint32_t> freeTiles;
+      for (uint32_t tile : index.tiles)
+        if (!is_occupied(index, tile))
+          freeTiles.push_back(tile);
+      // when everything is taken creatures have to share
+      if (!freeTiles.empty())
+        idx = freeTiles[rng.index(freeTiles.size())];
     }
+    occupy(index, idx);
+    res = Position{int(idx % dd.width), int(idx / dd.width)};
   });
   return res;
 }
 
+void dungeon::refresh_occupancy(flecs::world &ecs)
+{
+  static auto dungeonDataQuery = ecs.query<const DungeonData, WalkableIndex>();
+  static auto creaturesQuery = ecs.query<const Position, const Hitpoints>();
+
+  dungeonDataQuery.each([&](const DungeonData &dd, WalkableIndex &index)
+  {
+    for (uint32_t idx : index.occupiedTiles)
+      index.occupied[idx / 64] &= ~(uint64_t(1) << (idx % 64));
+    index.occupiedTiles.clear();
+    creaturesQuery.each([&](const Position &pos, const Hitpoints &)
+    {
+      if (pos.x >= 0 && pos.y >= 0 && pos.x < int(dd.width) && pos.y < int(dd.height))
+        occupy(index, uint32_t(size_t(pos.y) * dd.width + size_t(pos.x)));
+    });
+  });
+}
+
+static bool is_frontier(const DungeonData &dd, size_t idx)
+{
+  if (dd.tiles[idx] != dungeon::floor || dd.tilesExplore[idx] == dungeon::unexplored)
+    return false;
+  const size_t x = idx % dd.width;
+  const size_t y = idx / dd.width;
+  auto unexploredFloor = [&](size_t nidx)
+  {
+    return dd.tiles[nidx] == dungeon::floor && dd.tilesExplore[nidx] == dungeon::unexplored;
+  };
+  return (x > 0 && unexploredFloor(idx - 1)) || (x + 1 < dd.width && unexploredFloor(idx + 1)) ||
+         (y > 0 && unexploredFloor(idx - dd.width)) || (y + 1 < dd.height && unexploredFloor(idx + dd.width));
+}
+
+static void refresh_frontier_tile(const DungeonData &dd, ExploreFrontier &frontier, size_t idx)
+{
+  const bool inFrontier = frontier.slot[idx] != ExploreFrontier::npos;
+  if (is_frontier(dd, idx) == inFrontier)
+    return;
+  if (!inFrontier)
+  {
+    frontier.slot[idx] = frontier.tiles.size();
+    frontier.tiles.push_back(idx);
+    return;
+  }
+  // swap with the last one, order of the frontier doesn't matter
+  const size_t last = frontier.tiles.back();
+  frontier.tiles[frontier.slot[idx]] = last;
+  frontier.slot[last] = frontier.slot[idx];
+  frontier.tiles.pop_back();
+  frontier.slot[idx] = ExploreFrontier::npos;
+}
+
+void dungeon::init_frontier(const DungeonData &dd, ExploreFrontier &frontier)
+{
+  frontier.tiles.clear();
+  frontier.slot.assign(dd.width * dd.height, ExploreFrontier::npos);
+  for (size_t idx = 0; idx < dd.width * dd.height; ++idx)
+    refresh_frontier_tile(dd, frontier, idx);
+}
+
+void dungeon::on_tile_explored(const DungeonData &dd, ExploreFrontier &frontier, size_t idx)
+{
+  const size_t x = idx % dd.width;
+  const size_t y = idx / dd.width;
+  refresh_frontier_tile(dd, frontier, idx);
+  if (x > 0)
+    refresh_frontier_tile(dd, frontier, idx - 1);
+  if (x + 1 < dd.width)
+    refresh_frontier_tile(dd, frontier, idx + 1);
+  if (y > 0)
+    refresh_frontier_tile(dd, frontier, idx - dd.width);
+  if (y + 1 < dd.height)
+    refresh_frontier_tile(dd, frontier, idx + dd.width);
+}
+
 bool dungeon::is_tile_walkable(flecs::world &ecs, Position pos)
 {
   static auto dungeonDataQuery = ecs.query<const DungeonData>();
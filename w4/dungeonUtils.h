@@ -1,6 +1,7 @@
 #pragma once
 #include "ecsTypes.h"
 #include <flecs.h>
+#include "rng.h"
 
 namespace dungeon
 {
@@ -9,8 +10,18 @@ namespace dungeon
   constexpr char unexplored = '?';
   constexpr char explored = ' ';
 
-  Position find_walkable_tile(flecs::world &ecs);
+  // floor tiles are listed once when the dungeon is made
+  void init_walkable_index(const DungeonData &dd, WalkableIndex &index);
+  Position find_walkable_tile(flecs::world &ecs, rng::Rng &rng);
+  // random floor without a creature on it, expected O(1) while most of the floor is free,
+  // it's marked occupied right away so spawns in a row don't get the same tile
+  Position find_free_tile(flecs::world &ecs, rng::Rng &rng);
+  // occupancy from where creatures are now, after they moved or died
+  void refresh_occupancy(flecs::world &ecs);
   bool is_tile_walkable(flecs::world &ecs, Position pos);
-  Position find_neares_unexplore_tile(flecs::world &ecs, Position pos);
+  // full scan, done once when the dungeon is created
+  void init_frontier(const DungeonData &dd, ExploreFrontier &frontier);
+  // tile idx was just explored, only it and its neighbours can enter or leave the frontier
+  void on_tile_explored(const DungeonData &dd, ExploreFrontier &frontier, size_t idx);
   bool is_tile_visible(flecs::world &ecs, Position pos_from, Position pos_to);
 };
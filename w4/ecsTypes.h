@@ -1,10 +1,12 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <unordered_map>
 #include <functional>
 #include <flecs.h>
+#include "tileBuffer.h"
 
 // TODO: make a lot of seprate files
 struct Position;
@@ -26,12 +28,6 @@ struct Position
   Position &operator=(const MovePos &rhs);
 };
 
-struct NextExplorePos
-{
-  int x = 0;
-  int y = 0;
-};
-
 struct HealthThreshold
 {
   float hpThreshold = 60.f;
@@ -155,21 +151,72 @@ struct ActionLog
   size_t capacity = 5;
 };
 
-struct BackgroundTile {};
+// background of the whole map, an atlas cell for every tile, the atlas is a Texture2D
+// on the same entity
+struct TileMap
+{
+  size_t width = 0;
+  size_t height = 0;
+  int cellSize = 0; // of the atlas, in pixels
+  std::vector<uint8_t> ids;
+};
 
 struct DungeonData
 {
-  std::vector<char> tiles; // for pathfinding
+  TileBuffer tiles; // for pathfinding, can point into a mapped dungeon file
   std::vector<char> tilesExplore;
   size_t width;
   size_t height;
 };
 
+// floor tiles in a list to pick a random one in O(1), one bit per tile for the ones a creature
+// stands on, set bits are also listed so they're cleared without going over the whole map
+struct WalkableIndex
+{
+  std::vector<uint32_t> tiles;
+  std::vector<uint64_t> occupied;
+  std::vector<uint32_t> occupiedTiles;
+};
+
+// explored floor tiles that border unexplored floor, kept up to date as tiles are revealed
+struct ExploreFrontier
+{
+  static constexpr size_t npos = size_t(-1);
+  std::vector<size_t> tiles;
+  std::vector<size_t> slot; // position of a tile in tiles or npos
+};
+
 struct DijkstraMapData
 {
   std::vector<float> map;
 };
 
+// compact form of DijkstraMapData, value = map[i] * scale + offset, invalid marks unreachable tiles
+struct QuantizedDijkstraMapData
+{
+  static constexpr uint16_t invalid = 0xffff;
+  std::vector<uint16_t> map;
+  float scale = 1.f;
+  float offset = 0.f;
+};
+
+// map entities with this tag get QuantizedDijkstraMapData instead of DijkstraMapData
+struct CompactDmap {};
+
+// map entities with this tag get LazyDijkstraMapData, only maps seeded by points support it
+struct LazyDmap {};
+
+// lazy map entities with this tag also keep coarse levels that followers far from the seeds read,
+// for big maps where a lot of followers are spread all over it
+struct PyramidDmap {};
+
+// map that is computed on lookup, at(idx) expands the search until idx is settled
+struct LazyDijkstraMapData
+{
+  std::function<float(size_t)> at;
+  size_t size = 0;
+};
+
 struct VisualiseMap {};
 
 struct DmapWeights
@@ -178,11 +225,50 @@ struct DmapWeights
   {
     float mult = 1.f;
     float pow = 1.f;
-    std::function<bool(flecs::entity e)> usefunc = [&](flecs::entity e) { return true; };
+    // empty means the map is always used, such weights can be precomposed
+    std::function<bool(flecs::entity e)> usefunc;
   };
   std::unordered_map<std::string, WtData> weights;
 };
 
+// DmapWeights with map names resolved to entities, kept up to date by an OnSet observer
+struct CompiledDmapWeights
+{
+  // most profiles fit in place, entries past these go to overflow
+  static constexpr size_t inline_maps = 4;
+  struct Entry
+  {
+    flecs::entity map;
+    float mult = 1.f;
+    float pow = 1.f;
+    // copied from WtData, empty for weights that are part of the composite
+    std::function<bool(flecs::entity e)> usefunc;
+    // lazy maps are looked up per follower, they have no full map to compose
+    bool lazy = false;
+  };
+  Entry entries[inline_maps];
+  std::vector<Entry> overflow;
+  size_t count = 0;
+  // weights with the same contents share a profile and a composite map
+  size_t profile = 0;
+
+  Entry &operator[](size_t i) { return i < inline_maps ? entries[i] : overflow[i - inline_maps]; }
+  const Entry &operator[](size_t i) const { return i < inline_maps ? entries[i] : overflow[i - inline_maps]; }
+
+  Entry &add()
+  {
+    if (count++ < inline_maps)
+      return entries[count - 1] = Entry{};
+    return overflow.emplace_back();
+  }
+
+  void clear()
+  {
+    count = 0;
+    overflow.clear();
+  }
+};
+
 struct Hive {};
 
 struct IsAutoExplore
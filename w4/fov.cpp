@@ -0,0 +1,126 @@
+#include "fov.h"
+#include <algorithm>
+
+void fov::VisibilitySet::reset(Position origin, int radius)
+{
+  originPos = origin;
+  viewRadius = radius;
+  side = 2 * radius + 1;
+  bits.assign((size_t(side * side) + 63) / 64, 0);
+}
+
+void fov::VisibilitySet::set(int x, int y)
+{
+  const size_t bit = size_t((y - originPos.y + viewRadius) * side + x - originPos.x + viewRadius);
+  bits[bit >> 6] |= uint64_t(1) << (bit & 63);
+}
+
+// slopes are kept as exact fractions num / den with den > 0
+struct Slope
+{
+  int num;
+  int den;
+};
+
+static int floor_div(int a, int b)
+{
+  return a / b - ((a % b != 0) && ((a < 0) != (b < 0)) ? 1 : 0);
+}
+
+// depth * slope rounded with ties going up and down respectively
+static int round_ties_up(int depth, Slope s) { return floor_div(2 * depth * s.num + s.den, 2 * s.den); }
+static int round_ties_down(int depth, Slope s) { return -floor_div(-(2 * depth * s.num - s.den), 2 * s.den); }
+
+namespace
+{
+  struct Quadrant
+  {
+    const char *tiles;
+    size_t w;
+    size_t h;
+    char wall;
+    Position viewer;
+    int radius;
+    int dir; // 0 north, 1 east, 2 south, 3 west
+    fov::VisibilitySet &res;
+
+    Position transform(int depth, int col) const
+    {
+      switch (dir)
+      {
+        case 0: return Position{viewer.x + col, viewer.y - depth};
+        case 1: return Position{viewer.x + depth, viewer.y + col};
+        case 2: return Position{viewer.x + col, viewer.y + depth};
+        default: return Position{viewer.x - depth, viewer.y + col};
+      }
+    }
+
+    bool is_wall(Position p) const
+    {
+      if (p.x < 0 || p.y < 0 || p.x >= int(w) || p.y >= int(h))
+        return true;
+      return tiles[size_t(p.y) * w + size_t(p.x)] == wall;
+    }
+
+    void reveal(Position p) const
+    {
+      if (p.x >= 0 && p.y >= 0 && p.x < int(w) && p.y < int(h))
+        res.set(p.x, p.y);
+    }
+
+    void scan(int depth, Slope start, Slope end) const
+    {
+      if (depth > radius)
+        return;
+      const int minCol = std::max(round_ties_up(depth, start), -radius);
+      const int maxCol = std::min(round_ties_down(depth, end), radius);
+      int prev = -1; // -1 nothing yet, 0 floor, 1 wall
+      for (int col = minCol; col <= maxCol; ++col)
+      {
+        const Position p = transform(depth, col);
+        const bool wallTile = is_wall(p);
+        // floor is only revealed when it's inside the row's slopes, that's what keeps it symmetric
+        const bool symmetric = col * start.den >= depth * start.num && col * end.den <= depth * end.num;
+        if (wallTile || symmetric)
+          reveal(p);
+        const Slope tileSlope{2 * col - 1, 2 * depth};
+        if (prev == 1 && !wallTile)
+          start = tileSlope;
+        if (prev == 0 && wallTile)
+          scan(depth + 1, start, tileSlope);
+        prev = wallTile ? 1 : 0;
+      }
+      if (prev == 0)
+        scan(depth + 1, start, end);
+    }
+  };
+}
+
+void fov::compute(const char *tiles, size_t w, size_t h, char wall, Position viewer, int radius,
+                  VisibilitySet &res)
+{
+  res.reset(viewer, radius);
+  if (viewer.x >= 0 && viewer.y >= 0 && viewer.x < int(w) && viewer.y < int(h))
+    res.set(viewer.x, viewer.y);
+  for (int dir = 0; dir < 4; ++dir)
+    Quadrant{tiles, w, h, wall, viewer, radius, dir, res}.scan(1, Slope{-1, 1}, Slope{1, 1});
+}
+
+const fov::VisibilitySet &fov::FovCache::get(const char *tiles, size_t w, size_t h, char wall,
+                                             Position viewer, int radius)
+{
+  // cache is bounded, viewers that walk around a lot just start over
+  if (tiles != dungeonTiles || w != width || h != height || sets.size() > 4096)
+  {
+    dungeonTiles = tiles;
+    width = w;
+    height = h;
+    sets.clear();
+  }
+  const uint64_t key = (uint64_t(uint32_t(radius)) << 48) | (uint64_t(uint32_t(viewer.y) & 0xffffffu) << 24) |
+                       (uint32_t(viewer.x) & 0xffffffu);
+  auto [it, inserted] = sets.try_emplace(key);
+  if (inserted)
+    compute(tiles, w, h, wall, viewer, radius, it->second);
+  return it->second;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef> // size_t
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "ecsTypes.h"
+
+namespace fov
+{
+  // tiles visible from one viewer inside a (2 * radius + 1)^2 square around it
+  class VisibilitySet
+  {
+  public:
+    void reset(Position origin, int radius);
+    void set(int x, int y);
+    bool visible(Position pos) const
+    {
+      const int lx = pos.x - originPos.x + viewRadius;
+      const int ly = pos.y - originPos.y + viewRadius;
+      if (lx < 0 || ly < 0 || lx >= side || ly >= side)
+        return false;
+      const size_t bit = size_t(ly * side + lx);
+      return (bits[bit >> 6] >> (bit & 63)) & 1u;
+    }
+
+  private:
+    Position originPos{0, 0};
+    int viewRadius = 0;
+    int side = 1;
+    std::vector<uint64_t> bits;
+  };
+
+  // symmetric shadowcasting: floor tiles see each other both ways, walls are visible
+  // when any part of them is lit, everything outside of the dungeon counts as a wall
+  void compute(const char *tiles, size_t w, size_t h, char wall, Position viewer, int radius,
+               VisibilitySet &res);
+
+  // visibility sets cached per (viewer tile, radius) for a dungeon, dropped when tiles change
+  class FovCache
+  {
+  public:
+    const VisibilitySet &get(const char *tiles, size_t w, size_t h, char wall, Position viewer, int radius);
+
+  private:
+    const char *dungeonTiles = nullptr;
+    size_t width = 0;
+    size_t height = 0;
+    std::unordered_map<uint64_t, VisibilitySet> sets;
+  };
+};
@@ -0,0 +1,445 @@
+#pragma once
+#include <cstddef> // size_t
+#include <cstdlib> // abs
+#include <cmath>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+// Grid search with connectivity, cost model and heuristic chosen at compile time,
+// so every combination gets its own fully unrolled and inlined inner loop.
+namespace grid
+{
+  constexpr float sqrt2 = 1.41421356f;
+
+  struct Neighbourhood4
+  {
+    static constexpr size_t count = 4;
+    static constexpr int dx[count] = {1, -1, 0, 0};
+    static constexpr int dy[count] = {0, 0, 1, -1};
+    static constexpr float len[count] = {1.f, 1.f, 1.f, 1.f};
+  };
+
+  struct Neighbourhood8
+  {
+    static constexpr size_t count = 8;
+    static constexpr int dx[count] = {1, -1, 0, 0, 1, -1, 1, -1};
+    static constexpr int dy[count] = {0, 0, 1, -1, 1, 1, -1, -1};
+    static constexpr float len[count] = {1.f, 1.f, 1.f, 1.f, sqrt2, sqrt2, sqrt2, sqrt2};
+  };
+
+  template<char Wall>
+  struct UniformCost
+  {
+    static constexpr bool passable(char tile) { return tile != Wall; }
+    static constexpr float cost(char) { return 1.f; }
+  };
+
+  // entering a Heavy tile costs HeavyCost instead of 1
+  template<char Wall, char Heavy, int HeavyCost>
+  struct WeightedCost
+  {
+    static constexpr bool passable(char tile) { return tile != Wall; }
+    static constexpr float cost(char tile) { return tile == Heavy ? float(HeavyCost) : 1.f; }
+  };
+
+  struct Manhattan
+  {
+    static float estimate(int dx, int dy) { return float(abs(dx) + abs(dy)); }
+  };
+
+  struct Octile
+  {
+    static float estimate(int dx, int dy)
+    {
+      const int ax = abs(dx);
+      const int ay = abs(dy);
+      return float(std::max(ax, ay)) + (sqrt2 - 1.f) * float(std::min(ax, ay));
+    }
+  };
+
+  struct Euclidean
+  {
+    static float estimate(int dx, int dy) { return sqrtf(float(dx * dx + dy * dy)); }
+  };
+
+  // how tiles of a w x h grid are laid out in memory, every array a search touches
+  // (tiles, maps, scratch) has to use the same layout and Layout::size(w, h) elements
+  struct RowMajor
+  {
+    static size_t size(size_t w, size_t h) { return w * h; }
+    static size_t index(int x, int y, size_t w) { return size_t(y) * w + size_t(x); }
+    static int x_of(size_t idx, size_t w) { return int(idx % w); }
+    static int y_of(size_t idx, size_t w) { return int(idx / w); }
+    // index of the (dx, dy) neighbour of idx, false if it's outside the w x h grid
+    static bool step(size_t idx, int dx, int dy, size_t w, size_t h, size_t &res)
+    {
+      const int nx = x_of(idx, w) + dx;
+      const int ny = y_of(idx, w) + dy;
+      if (nx < 0 || ny < 0 || nx >= int(w) || ny >= int(h))
+        return false;
+      res = index(nx, ny, w);
+      return true;
+    }
+  };
+
+  // 8x8 blocks one after another, vertical neighbours are 8 elements away instead of a whole row,
+  // grid is padded up to whole blocks and padding has to be impassable
+  struct Tiled8
+  {
+    static size_t blocks(size_t n) { return (n + 7) >> 3; }
+    static size_t size(size_t w, size_t h) { return blocks(w) * blocks(h) * 64; }
+    static size_t index(int x, int y, size_t w)
+    {
+      return ((size_t(y) >> 3) * blocks(w) + (size_t(x) >> 3)) * 64 + ((size_t(y) & 7) << 3) + (size_t(x) & 7);
+    }
+    static int x_of(size_t idx, size_t w) { return int((idx >> 6) % blocks(w) * 8 + (idx & 7)); }
+    static int y_of(size_t idx, size_t w) { return int((idx >> 6) / blocks(w) * 8 + ((idx >> 3) & 7)); }
+    // inside a block it's a plain offset, only steps out of it decode the position
+    static bool step(size_t idx, int dx, int dy, size_t w, size_t h, size_t &res)
+    {
+      const int lx = int(idx & 7) + dx;
+      const int ly = int((idx >> 3) & 7) + dy;
+      if (lx >= 0 && ly >= 0 && lx < 8 && ly < 8)
+      {
+        res = idx + size_t(dy * 8 + dx);
+        return true;
+      }
+      const int nx = x_of(idx, w) + dx;
+      const int ny = y_of(idx, w) + dy;
+      if (nx < 0 || ny < 0 || nx >= int(w) || ny >= int(h))
+        return false;
+      res = index(nx, ny, w);
+      return true;
+    }
+  };
+
+  // copies a row-major grid into Layout order, padding gets fill
+  template<typename Layout, typename T>
+  void to_layout(const T *rowMajor, size_t w, size_t h, T fill, std::vector<T> &res)
+  {
+    res.assign(Layout::size(w, h), fill);
+    for (size_t y = 0; y < h; ++y)
+      for (size_t x = 0; x < w; ++x)
+        res[Layout::index(int(x), int(y), w)] = rowMajor[y * w + x];
+  }
+
+  template<size_t... I, typename Callable>
+  inline void unroll(std::index_sequence<I...>, Callable &&c)
+  {
+    (c(std::integral_constant<size_t, I>{}), ...);
+  }
+
+  // Dial's bucket queue with unit-width buckets, every step has to cost at least 1
+  // so popping from a bucket only pushes into later ones.
+  // Buckets keep their capacity between runs.
+  class BucketQueue
+  {
+  public:
+    void reset(float base)
+    {
+      baseValue = base;
+      current = 0;
+      head = 0;
+      for (std::vector<std::pair<float, size_t>> &bucket : buckets)
+        bucket.clear();
+    }
+
+    void push(float value, size_t idx)
+    {
+      // rounding can't put anything into a bucket that was already drained
+      const size_t b = std::max(size_t(value - baseValue), current);
+      if (b >= buckets.size())
+        buckets.resize(b + 1);
+      buckets[b].emplace_back(value, idx);
+    }
+
+    // calls c(idx, value) in bucket order, c is allowed to push
+    template<typename Callable>
+    void drain(Callable c)
+    {
+      for (current = 0; current < buckets.size(); ++current)
+      {
+        for (size_t i = 0; i < buckets[current].size(); ++i)
+          c(buckets[current][i].second, buckets[current][i].first);
+        buckets[current].clear();
+      }
+    }
+
+    // pops one entry at a time so a search can be paused and resumed, false once it's empty,
+    // not to be mixed with drain between two resets
+    bool pop(size_t &idx, float &value)
+    {
+      for (; current < buckets.size(); ++current, head = 0)
+      {
+        if (head < buckets[current].size())
+        {
+          value = buckets[current][head].first;
+          idx = buckets[current][head].second;
+          ++head;
+          return true;
+        }
+        buckets[current].clear();
+      }
+      return false;
+    }
+
+  private:
+    float baseValue = 0.f;
+    size_t current = 0;
+    size_t head = 0;
+    std::vector<std::vector<std::pair<float, size_t>>> buckets;
+  };
+
+  struct NoExpandCallback
+  {
+    void operator()(int, int, float) const {}
+  };
+
+  template<typename Neighbourhood, typename CostPolicy, typename Heuristic, typename LayoutPolicy = RowMajor>
+  struct GridSearch
+  {
+    using Layout = LayoutPolicy;
+    using Cost = CostPolicy;
+    static constexpr size_t invalid_idx = std::numeric_limits<size_t>::max();
+
+    // calls c(neighbourIdx, nx, ny, stepLength) for every passable neighbour of (x, y) inside [min, max)
+    template<typename Callable>
+    static void for_each_neighbour(const char *tiles, size_t w, int x, int y,
+                                   int min_x, int min_y, int max_x, int max_y, Callable &&c)
+    {
+      unroll(std::make_index_sequence<Neighbourhood::count>{}, [&](auto i)
+      {
+        constexpr int dx = Neighbourhood::dx[i];
+        constexpr int dy = Neighbourhood::dy[i];
+        const int nx = x + dx;
+        const int ny = y + dy;
+        if (nx < min_x || ny < min_y || nx >= max_x || ny >= max_y)
+          return;
+        const size_t nidx = LayoutPolicy::index(nx, ny, w);
+        const char tile = tiles[nidx];
+        if (!CostPolicy::passable(tile))
+          return;
+        if constexpr (dx != 0 && dy != 0)
+        {
+          // don't cut corners
+          if (!CostPolicy::passable(tiles[LayoutPolicy::index(nx, y, w)]) ||
+              !CostPolicy::passable(tiles[LayoutPolicy::index(x, ny, w)]))
+            return;
+        }
+        c(nidx, nx, ny, Neighbourhood::len[i]);
+      });
+    }
+
+    // same over the whole w x h grid for a tile known only by its index, calls c(neighbourIdx, stepLength),
+    // lets the layout step to neighbours without decoding the position
+    template<typename Callable>
+    static void for_each_neighbour(const char *tiles, size_t w, size_t h, size_t idx, Callable &&c)
+    {
+      unroll(std::make_index_sequence<Neighbourhood::count>{}, [&](auto i)
+      {
+        constexpr int dx = Neighbourhood::dx[i];
+        constexpr int dy = Neighbourhood::dy[i];
+        size_t nidx = 0;
+        if (!LayoutPolicy::step(idx, dx, dy, w, h, nidx) || !CostPolicy::passable(tiles[nidx]))
+          return;
+        if constexpr (dx != 0 && dy != 0)
+        {
+          // don't cut corners, both sides are inside the grid if the diagonal is
+          size_t sideX = 0;
+          size_t sideY = 0;
+          LayoutPolicy::step(idx, dx, 0, w, h, sideX);
+          LayoutPolicy::step(idx, 0, dy, w, h, sideY);
+          if (!CostPolicy::passable(tiles[sideX]) || !CostPolicy::passable(tiles[sideY]))
+            return;
+        }
+        c(nidx, Neighbourhood::len[i]);
+      });
+    }
+
+    template<typename Vec>
+    static std::vector<Vec> reconstruct_path(const std::vector<size_t> &prev, size_t to, size_t w)
+    {
+      std::vector<Vec> res;
+      for (size_t idx = to; idx != invalid_idx; idx = prev[idx])
+        res.push_back(Vec{LayoutPolicy::x_of(idx, w), LayoutPolicy::y_of(idx, w)});
+      std::reverse(res.begin(), res.end());
+      return res;
+    }
+
+    // A* inside [lim_min, lim_max), weight > 1 turns it into weighted A*
+    template<typename Vec, typename OnExpand = NoExpandCallback>
+    static std::vector<Vec> find_path(const char *tiles, size_t w, size_t h, Vec from, Vec to,
+                                      Vec lim_min, Vec lim_max, float weight = 1.f,
+                                      OnExpand on_expand = OnExpand{})
+    {
+      if (from.x < 0 || from.y < 0 || from.x >= int(w) || from.y >= int(h))
+        return std::vector<Vec>();
+      const size_t inpSize = LayoutPolicy::size(w, h);
+      const size_t toIdx = LayoutPolicy::index(to.x, to.y, w);
+
+      std::vector<float> g(inpSize, std::numeric_limits<float>::max());
+      std::vector<size_t> prev(inpSize, invalid_idx);
+      std::vector<bool> closed(inpSize, false);
+
+      using OpenEntry = std::pair<float, size_t>;
+      std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry>> openList;
+
+      const size_t fromIdx = LayoutPolicy::index(from.x, from.y, w);
+      g[fromIdx] = 0.f;
+      openList.push({weight * Heuristic::estimate(to.x - from.x, to.y - from.y), fromIdx});
+
+      while (!openList.empty())
+      {
+        const size_t idx = openList.top().second;
+        openList.pop();
+        if (idx == toIdx)
+          return reconstruct_path<Vec>(prev, toIdx, w);
+        if (closed[idx])
+          continue;
+        closed[idx] = true;
+        const int x = LayoutPolicy::x_of(idx, w);
+        const int y = LayoutPolicy::y_of(idx, w);
+        on_expand(x, y, g[idx]);
+        for_each_neighbour(tiles, w, x, y, lim_min.x, lim_min.y, lim_max.x, lim_max.y,
+          [&](size_t nidx, int nx, int ny, float len)
+          {
+            const float gScore = g[idx] + len * CostPolicy::cost(tiles[nidx]);
+            if (gScore < g[nidx])
+            {
+              prev[nidx] = idx;
+              g[nidx] = gScore;
+              openList.push({gScore + weight * Heuristic::estimate(to.x - nx, to.y - ny), nidx});
+            }
+          });
+      }
+      // empty path
+      return std::vector<Vec>();
+    }
+
+    template<typename Vec>
+    static std::vector<Vec> find_path(const char *tiles, size_t w, size_t h, Vec from, Vec to, float weight = 1.f)
+    {
+      return find_path(tiles, w, h, from, to, Vec{0, 0}, Vec{int(w), int(h)}, weight);
+    }
+
+    template<typename Vec>
+    static float ida_search(const char *tiles, size_t w, size_t h, std::vector<Vec> &path,
+                            const float g, const float bound, Vec to)
+    {
+      const Vec p = path.back();
+      const float f = g + Heuristic::estimate(to.x - p.x, to.y - p.y);
+      if (f > bound)
+        return f;
+      if (p.x == to.x && p.y == to.y)
+        return -f;
+      float min = std::numeric_limits<float>::max();
+      float found = 0.f;
+      for_each_neighbour(tiles, w, p.x, p.y, 0, 0, int(w), int(h),
+        [&](size_t nidx, int nx, int ny, float len)
+        {
+          if (found < 0.f)
+            return;
+          const Vec np{nx, ny};
+          if (std::find_if(path.begin(), path.end(),
+                [&](const Vec &v) { return v.x == nx && v.y == ny; }) != path.end())
+            return;
+          path.push_back(np);
+          const float t = ida_search(tiles, w, h, path, g + len * CostPolicy::cost(tiles[nidx]), bound, to);
+          if (t < 0.f)
+          {
+            found = t;
+            return;
+          }
+          min = std::min(min, t);
+          path.pop_back();
+        });
+      return found < 0.f ? found : min;
+    }
+
+    template<typename Vec>
+    static std::vector<Vec> find_path_ida(const char *tiles, size_t w, size_t h, Vec from, Vec to)
+    {
+      std::vector<Vec> path = {from};
+      if (from.x == to.x && from.y == to.y)
+        return path;
+      float bound = Heuristic::estimate(to.x - from.x, to.y - from.y);
+      while (true)
+      {
+        const float t = ida_search(tiles, w, h, path, 0.f, bound, to);
+        if (t < 0.f)
+          return path;
+        if (t == std::numeric_limits<float>::max())
+          return {};
+        bound = t;
+      }
+      return {};
+    }
+
+    // relaxes a dijkstra map in place until nothing changes, seeds are the initial values
+    static void scan_dmap(float *map, const char *tiles, size_t w, size_t h)
+    {
+      bool done = false;
+      while (!done)
+      {
+        done = true;
+        for (size_t y = 0; y < h; ++y)
+          for (size_t x = 0; x < w; ++x)
+          {
+            const size_t i = LayoutPolicy::index(int(x), int(y), w);
+            if (!CostPolicy::passable(tiles[i]))
+              continue;
+            const float cost = CostPolicy::cost(tiles[i]);
+            float minVal = map[i];
+            for_each_neighbour(tiles, w, int(x), int(y), 0, 0, int(w), int(h),
+              [&](size_t nidx, int, int, float len)
+              {
+                minVal = std::min(minVal, map[nidx] + len * cost);
+              });
+            if (minVal < map[i])
+            {
+              map[i] = minVal;
+              done = false;
+            }
+          }
+      }
+    }
+
+    // same fixed point as scan_dmap, but every tile is settled once in increasing value order,
+    // tiles with values >= unreached are not seeds
+    static void bucket_dmap(float *map, const char *tiles, size_t w, size_t h, float unreached,
+                            BucketQueue &queue)
+    {
+      const size_t count = LayoutPolicy::size(w, h);
+      float base = unreached;
+      for (size_t i = 0; i < count; ++i)
+        if (map[i] < base && CostPolicy::passable(tiles[i]))
+          base = map[i];
+      if (base >= unreached)
+        return;
+      queue.reset(base);
+      for (size_t i = 0; i < count; ++i)
+        if (map[i] < unreached && CostPolicy::passable(tiles[i]))
+          queue.push(map[i], i);
+      queue.drain([&](size_t idx, float val)
+      {
+        // lowered after it was pushed, the newer entry settles it
+        if (map[idx] != val)
+          return;
+        for_each_neighbour(tiles, w, h, idx,
+          [&](size_t nidx, float len)
+          {
+            const float nval = val + len * CostPolicy::cost(tiles[nidx]);
+            if (nval < map[nidx])
+            {
+              map[nidx] = nval;
+              queue.push(nval, nidx);
+            }
+          });
+      });
+    }
+  };
+};
@@ -1,32 +1,40 @@
 //
 #include "raylib.h"
 #include <flecs.h>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
 #include <algorithm>
+#include <random>
 #include "ecsTypes.h"
 #include "roguelike.h"
 #include "dungeonGen.h"
 #include "dungeonUtils.h"
 
-static void update_camera(Camera2D &cam, flecs::world &ecs)
+static void update_camera(flecs::world &ecs)
 {
+  static auto cameraQuery = ecs.query<Camera2D>();
   static auto playerQuery = ecs.query<const Position, const IsPlayer>();
 
-  playerQuery.each([&](const Position &pos, const IsPlayer &)
+  cameraQuery.each([&](Camera2D &cam)
   {
-    cam.target.x += (pos.x * tile_size - cam.target.x) * 0.1f;
-    cam.target.y += (pos.y * tile_size - cam.target.y) * 0.1f;
+    playerQuery.each([&](const Position &pos, const IsPlayer &)
+    {
+      cam.target.x += (pos.x * tile_size - cam.target.x) * 0.1f;
+      cam.target.y += (pos.y * tile_size - cam.target.y) * 0.1f;
+    });
   });
 }
 
-static void update_vis_map(flecs::world &ecs, flecs::entity wallTex, flecs::entity floorTex)
+static void update_vis_map(flecs::world &ecs)
 {
   static auto playerQuery = ecs.query<const Position, const IsPlayer>();
 
-  static auto dungeonDataQuery = ecs.query<DungeonData>();
+  static auto dungeonDataQuery = ecs.query<DungeonData, ExploreFrontier, TileMap>();
 
   playerQuery.each([&](const Position &pos, const IsPlayer &)
   {
-    dungeonDataQuery.each([&](DungeonData &dd)
+    dungeonDataQuery.each([&](DungeonData &dd, ExploreFrontier &frontier, TileMap &tileMap)
     {
       for (int i = -3; i <= 3; ++i)
       {
@@ -38,25 +46,8 @@ static void update_vis_map(flecs::world &ecs, flecs::entity wallTex, flecs::enti
           if (abs(i) + abs(j) <= 3 && dd.tilesExplore[(pos.y + i) * dd.width + pos.x + j] == dungeon::unexplored)
           {
             dd.tilesExplore[(pos.y + i) * dd.width + pos.x + j] = dungeon::explored;
-            char tile = dd.tiles[(pos.y + i) * dd.width + pos.x + j];
-            static auto tilesQuery = ecs.query<const Position, const BackgroundTile>();
-            flecs::entity tileEntity;
-            tilesQuery.each([&](flecs::entity entity, const Position &tpos, const BackgroundTile &)
-            {
-              if (tpos == Position{int(pos.x + j), int(pos.y + i)})
-              {
-                tileEntity = entity;
-              }
-            });
-            tileEntity.set(Color{255, 255, 255, 255});
-            if (tile == dungeon::floor)
-            {
-              tileEntity.add<TextureSource>(floorTex);
-            }
-            else if (tile == dungeon::wall)
-            {
-              tileEntity.add<TextureSource>(wallTex);
-            }
+            dungeon::on_tile_explored(dd, frontier, (pos.y + i) * dd.width + pos.x + j);
+            tileMap.ids[(pos.y + i) * dd.width + pos.x + j] = background_cell(dd.tiles[(pos.y + i) * dd.width + pos.x + j]);
           }
         }
       }
@@ -64,8 +55,12 @@ static void update_vis_map(flecs::world &ecs, flecs::entity wallTex, flecs::enti
   });
 }
 
-int main(int /*argc*/, const char ** /*argv*/)
+int main(int argc, const char **argv)
 {
+  // pass a seed to replay the same dungeon and the same random decisions
+  const uint64_t seed = argc > 1 ? strtoull(argv[1], nullptr, 10) : std::random_device{}();
+  printf("seed %" PRIu64 "\n", seed);
+  rng::Rng rng(seed);
   int width = 1920;
   int height = 1080;
   InitWindow(width, height, "w3 AI MIPT");
@@ -81,36 +76,50 @@ int main(int /*argc*/, const char ** /*argv*/)
 
   flecs::world ecs;
   {
-    constexpr size_t dungWidth = 50;
-    constexpr size_t dungHeight = 50;
-    char *tiles = new char[dungWidth * dungHeight];
-    char *tilesExplore = new char[dungWidth * dungHeight];
-    gen_drunk_dungeon(tiles, tilesExplore, dungWidth, dungHeight);
-    init_dungeon(ecs, tiles, tilesExplore, dungWidth, dungHeight);
+    // a map file after the seed is loaded when it's there, a new dungeon is saved to it otherwise,
+    // the dungeon has a stream of its own, so the game goes the same way either way
+    rng::Rng dungeonRng = rng.split();
+    mapfile::Dungeon map;
+    if (argc <= 2 || !mapfile::load(argv[2], map))
+    {
+      constexpr size_t dungWidth = 50;
+      constexpr size_t dungHeight = 50;
+      std::vector<char> tiles(dungWidth * dungHeight);
+      std::vector<char> tilesExplore(dungWidth * dungHeight);
+      gen_drunk_dungeon(tiles.data(), tilesExplore.data(), dungWidth, dungHeight, dungeonRng);
+      map.info = mapfile::Info{dungWidth, dungHeight, seed, "drunk"};
+      if (argc > 2)
+        mapfile::save(argv[2], map.info, tiles.data(), tilesExplore.data(), mapfile::Encoding::raw);
+      map.tiles = TileBuffer(std::move(tiles));
+      map.explore = TileBuffer(std::move(tilesExplore));
+    }
+    else if (map.info.seed != seed)
+      printf("%s was made with seed %" PRIu64 "\n", argv[2], map.info.seed);
+    init_dungeon(ecs, map);
   }
-  flecs::entity wallTex = ecs.entity("wall_tex")
-    .set(Texture2D{LoadTexture("assets/wall.png")});
-  flecs::entity floorTex = ecs.entity("floor_tex")
-    .set(Texture2D{LoadTexture("assets/floor.png")});
-  init_roguelike(ecs);
-  update_vis_map(ecs, wallTex, floorTex);
+  init_roguelike(ecs, rng);
+  update_vis_map(ecs);
 
   Camera2D camera = { {0, 0}, {0, 0}, 0.f, 1.f };
   camera.target = Vector2{ 0.f, 0.f };
   camera.offset = Vector2{ width * 0.5f, height * 0.5f };
   camera.rotation = 0.f;
   camera.zoom = 0.125f;
+  // the background only draws tiles the camera sees
+  ecs.entity("camera")
+    .set(Camera2D{camera});
 
   SetTargetFPS(60);               // Set our game to run at 60 frames-per-second
   while (!WindowShouldClose())
   {
+    static auto cameraQuery = ecs.query<Camera2D>();
     process_turn(ecs);
-    update_vis_map(ecs, wallTex, floorTex);
-    update_camera(camera, ecs);
+    update_vis_map(ecs);
+    update_camera(ecs);
 
     BeginDrawing();
       ClearBackground(BLACK);
-      BeginMode2D(camera);
+      cameraQuery.each([&](Camera2D &cam) { BeginMode2D(cam); });
         ecs.progress();
       EndMode2D();
       print_stats(ecs);
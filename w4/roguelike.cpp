@@ -6,8 +6,10 @@
 #include "blackboard.h"
 #include "math.h"
 #include "dungeonUtils.h"
+#include "tileMap.h"
 #include "dijkstraMapGen.h"
 #include "dmapFollower.h"
+#include "dmapComposite.h"
 
 static flecs::entity create_magician_monster(flecs::entity e)
 {
@@ -112,28 +114,9 @@ static void create_minotaur_beh(flecs::entity e)
   e.set(BehaviourTree{root});
 }
 
-static Position find_free_dungeon_tile(flecs::world &ecs)
+static flecs::entity create_monster(flecs::world &ecs, rng::Rng &rng, Color col, const char *texture_src)
 {
-  static auto findMonstersQuery = ecs.query<const Position, const Hitpoints>();
-  bool done = false;
-  while (!done)
-  {
-    done = true;
-    Position pos = dungeon::find_walkable_tile(ecs);
-    findMonstersQuery.each([&](const Position &p, const Hitpoints&)
-    {
-      if (p == pos)
-        done = false;
-    });
-    if (done)
-      return pos;
-  };
-  return {0, 0};
-}
-
-static flecs::entity create_monster(flecs::world &ecs, Color col, const char *texture_src)
-{
-  Position pos = find_free_dungeon_tile(ecs);
+  Position pos = dungeon::find_free_tile(ecs, rng);
 
   flecs::entity textureSrc = ecs.entity(texture_src);
   return ecs.entity()
@@ -147,12 +130,13 @@ static flecs::entity create_monster(flecs::world &ecs, Color col, const char *te
     .set(Team{1})
     .set(NumActions{1, 0})
     .set(MeleeDamage{20.f})
-    .set(Blackboard{});
+    .set(Blackboard{})
+    .set(rng.split()); // own stream for its random moves
 }
 
-static void create_player(flecs::world &ecs, const char *texture_src)
+static void create_player(flecs::world &ecs, rng::Rng &rng, const char *texture_src)
 {
-  Position pos = find_free_dungeon_tile(ecs);
+  Position pos = dungeon::find_free_tile(ecs, rng);
 
   flecs::entity textureSrc = ecs.entity(texture_src);
   ecs.entity("player")
@@ -168,7 +152,6 @@ static void create_player(flecs::world &ecs, const char *texture_src)
     .set(Color{255, 255, 255, 255})
     .add<TextureSource>(textureSrc)
     .set(MeleeDamage{20.f})
-    .set(NextExplorePos{pos.x, pos.y})
     .set(DmapWeights{{{"explore_map", {1.f, 1.f}}}});
 }
 
@@ -220,15 +203,13 @@ static void register_roguelike_systems(flecs::world &ecs)
         a.action = EA_PASS;
       inp.passed = pass;
     });
-  ecs.system<const Position, const Color>()
-    .term<TextureSource>(flecs::Wildcard)
-    .term<BackgroundTile>()
-    .each([&](flecs::entity e, const Position &pos, const Color color)
+  static auto cameraQuery = ecs.query<const Camera2D>();
+  ecs.system<const TileMap, const Texture2D>()
+    .each([&](const TileMap &map, const Texture2D &atlas)
     {
-      const auto textureSrc = e.target<TextureSource>();
-      DrawTextureQuad(*textureSrc.get<Texture2D>(),
-          Vector2{1, 1}, Vector2{0, 0},
-          Rectangle{float(pos.x) * tile_size, float(pos.y) * tile_size, tile_size, tile_size}, color);
+      const Camera2D *camera = nullptr;
+      cameraQuery.each([&](const Camera2D &cam) { camera = &cam; });
+      tilemap::draw(map, atlas, tile_size, camera);
     });
   ecs.system<const Position, const Color>()
     .term<TextureSource>(flecs::Wildcard).not_()
@@ -239,7 +220,6 @@ static void register_roguelike_systems(flecs::world &ecs)
     });
   ecs.system<const Position, const Color>()
     .term<TextureSource>(flecs::Wildcard)
-    .term<BackgroundTile>().not_()
     .each([&](flecs::entity e, const Position &pos, const Color color)
     {
       const auto textureSrc = e.target<TextureSource>();
@@ -265,29 +245,44 @@ static void register_roguelike_systems(flecs::world &ecs)
     {
       SetTextureFilter(tex, TEXTURE_FILTER_POINT);
     });
-  ecs.system<const DmapWeights>()
+  ecs.system<const CompiledDmapWeights>()
     .term<VisualiseMap>()
-    .each([&](const DmapWeights &wt)
+    .each([&](const CompiledDmapWeights &cw)
     {
       dungeonDataQuery.each([&](const DungeonData &dd)
       {
+        // conditional weights can't be evaluated without a follower, show them as always on,
+        // the composite is only copied when there are such weights to add on top of it
+        const std::vector<float> &composite = dmaps::get_composite(cw);
+        bool hasExtra = false;
+        for (size_t i = 0; i < cw.count; ++i)
+          hasExtra |= cw[i].usefunc || cw[i].lazy;
+        static std::vector<float> withExtra;
+        if (hasExtra)
+        {
+          withExtra = composite;
+          for (size_t i = 0; i < cw.count; ++i)
+          {
+            const CompiledDmapWeights::Entry &entry = cw[i];
+            if (!entry.usefunc && !entry.lazy)
+              continue;
+            dmaps::DmapView view;
+            if (!dmaps::get_view(entry.map, view))
+              continue;
+            if (withExtra.empty())
+              withExtra.assign(view.size, 0.f);
+            dmaps::accumulate_weighted(withExtra.data(), view, std::min(withExtra.size(), view.size), entry.mult, entry.pow);
+          }
+        }
+        const std::vector<float> &sum = hasExtra ? withExtra : composite;
+        if (sum.size() < dmaps::Layout::size(dd.width, dd.height))
+          return;
         for (size_t y = 0; y < dd.height; ++y)
           for (size_t x = 0; x < dd.width; ++x)
           {
-            float sum = 0.f;
-            for (const auto &pair : wt.weights)
-            {
-              ecs.entity(pair.first.c_str()).get([&](const DijkstraMapData &dmap)
-              {
-                float v = dmap.map[y * dd.width + x];
-                if (v < 1e5f)
-                  sum += powf(v * pair.second.mult, pair.second.pow);
-                else
-                  sum += v;
-              });
-            }
-            if (sum < 1e5f)
-              DrawText(TextFormat("%.1f", sum),
+            const float val = sum[dmaps::tile_index(int(x), int(y), dd.width)];
+            if (val < 1e5f)
+              DrawText(TextFormat("%.1f", val),
                   (float(x) + 0.2f) * tile_size, (float(y) + 0.5f) * tile_size, 150, WHITE);
           }
       });
@@ -301,17 +296,34 @@ static void register_roguelike_systems(flecs::world &ecs)
         for (size_t y = 0; y < dd.height; ++y)
           for (size_t x = 0; x < dd.width; ++x)
           {
-            const float val = dmap.map[y * dd.width + x];
+            const float val = dmap.map[dmaps::tile_index(int(x), int(y), dd.width)];
             if (val < 1e5f)
               DrawText(TextFormat("%.1f", val),
                   (float(x) + 0.2f) * tile_size, (float(y) + 0.5f) * tile_size, 150, WHITE);
           }
       });
     });
+  ecs.system<const QuantizedDijkstraMapData>()
+    .term<VisualiseMap>()
+    .each([](const QuantizedDijkstraMapData &dmap)
+    {
+      dungeonDataQuery.each([&](const DungeonData &dd)
+      {
+        for (size_t y = 0; y < dd.height; ++y)
+          for (size_t x = 0; x < dd.width; ++x)
+          {
+            const uint16_t q = dmap.map[dmaps::tile_index(int(x), int(y), dd.width)];
+            const float val = float(q) * dmap.scale + dmap.offset;
+            if (q != QuantizedDijkstraMapData::invalid)
+              DrawText(TextFormat("%.1f", val),
+                  (float(x) + 0.2f) * tile_size, (float(y) + 0.5f) * tile_size, 150, WHITE);
+          }
+      });
+    });
 }
 
 
-void init_roguelike(flecs::world &ecs)
+void init_roguelike(flecs::world &ecs, rng::Rng &rng)
 {
   register_roguelike_systems(ecs);
 
@@ -320,6 +332,37 @@ void init_roguelike(flecs::world &ecs)
   ecs.entity("minotaur_tex")
     .set(Texture2D{LoadTexture("assets/minotaur.png")});
 
+  // maps of whole step counts are stored exactly in half the bytes, flee is scaled and
+  // would lose its fractions, so it stays float like any map that isn't tagged
+  for (const char *name : {"explore_map", "approach_map", "hive_map", "magician_map", "teammate_map"})
+    ecs.entity(name).add<CompactDmap>();
+  // followers of these stay close to the seeds, they are only searched as far as they look
+  for (const char *name : {"explore_map", "hive_map", "teammate_map"})
+    ecs.entity(name).add<LazyDmap>();
+
+  // compiled into a local first, adding the component moves the entity and wt with it
+  ecs.observer<const DmapWeights>()
+    .event(flecs::OnSet)
+    .each([](flecs::entity e, const DmapWeights &wt)
+    {
+      flecs::world ecs = e.world();
+      CompiledDmapWeights cw;
+      dmaps::compile_weights(ecs, wt, cw);
+      dmaps::set_consumer(e, wt);
+      e.set(cw);
+    });
+  // fires for deleted entities too, so dead monsters stop keeping their maps alive
+  ecs.observer<const DmapWeights>()
+    .event(flecs::OnRemove)
+    .each([](flecs::entity e, const DmapWeights &)
+    {
+      dmaps::remove_consumer(e);
+    });
+  // shows a sum of maps, it reads them like a follower and keeps them generated while it's there
+  // ecs.entity("hive_follower_sum")
+  //   .set(DmapWeights{{{"hive_map", {1.f, 1.f}}, {"approach_map", {1.8f, 0.8f}}}})
+  //   .add<VisualiseMap>();
+
   ecs.observer<Texture2D>()
     .event(flecs::OnRemove)
     .each([](Texture2D texture)
@@ -327,60 +370,55 @@ void init_roguelike(flecs::world &ecs)
         UnloadTexture(texture);
       });
 
-  create_hive_monster(create_monster(ecs, Color{0xee, 0x00, 0xee, 0xff}, "minotaur_tex"));
-  create_hive_monster(create_monster(ecs, Color{0xee, 0x00, 0xee, 0xff}, "minotaur_tex"));
-  create_hive_monster(create_monster(ecs, Color{0x11, 0x11, 0x11, 0xff}, "minotaur_tex"));
-  create_magician_monster(create_monster(ecs, Color{0x0f, 0x0e, 0xef, 0xff}, "minotaur_tex"));
-  create_magician_monster(create_monster(ecs, Color{0x0f, 0x0e, 0xef, 0xff}, "minotaur_tex"));
-  create_hive(create_player_fleer(create_monster(ecs, Color{0, 255, 0, 255}, "minotaur_tex")));
+  create_hive_monster(create_monster(ecs, rng, Color{0xee, 0x00, 0xee, 0xff}, "minotaur_tex"));
+  create_hive_monster(create_monster(ecs, rng, Color{0xee, 0x00, 0xee, 0xff}, "minotaur_tex"));
+  create_hive_monster(create_monster(ecs, rng, Color{0x11, 0x11, 0x11, 0xff}, "minotaur_tex"));
+  create_magician_monster(create_monster(ecs, rng, Color{0x0f, 0x0e, 0xef, 0xff}, "minotaur_tex"));
+  create_magician_monster(create_monster(ecs, rng, Color{0x0f, 0x0e, 0xef, 0xff}, "minotaur_tex"));
+  create_hive(create_player_fleer(create_monster(ecs, rng, Color{0, 255, 0, 255}, "minotaur_tex")));
 
-  create_player(ecs, "swordsman_tex");
+  create_player(ecs, rng, "swordsman_tex");
 
   ecs.entity("world")
     .set(TurnCounter{})
     .set(ActionLog{});
 }
 
-void init_dungeon(flecs::world &ecs, char *tiles, char *tilesExplore, size_t w, size_t h)
+void init_dungeon(flecs::world &ecs, const mapfile::Dungeon &map)
 {
-  // flecs::entity wallTex = ecs.entity("wall_tex")
-  //   .set(Texture2D{LoadTexture("assets/wall.png")});
-  // flecs::entity floorTex = ecs.entity("floor_tex")
-  //   .set(Texture2D{LoadTexture("assets/floor.png")});
-
-  std::vector<char> dungeonData;
-  std::vector<char> dungeonDataTilesExplore;
-  dungeonData.resize(w * h);
-  dungeonDataTilesExplore.resize(w * h);
-  for (size_t y = 0; y < h; ++y)
-  {
-    for (size_t x = 0; x < w; ++x)
-    {
-      dungeonData[y * w + x] = tiles[y * w + x];
-      dungeonDataTilesExplore[y * w + x] = tilesExplore[y * w + x];
-    }
-  }
+  const size_t w = map.info.width;
+  const size_t h = map.info.height;
+  // tiles are shared with the map, exploring changes the explore layer so it's a copy
+  std::vector<char> tilesExplore(w * h, dungeon::unexplored);
+  if (!map.explore.empty())
+    tilesExplore.assign(map.explore.data(), map.explore.data() + map.explore.size());
+  DungeonData dd{map.tiles, std::move(tilesExplore), w, h};
+  ExploreFrontier frontier;
+  dungeon::init_frontier(dd, frontier);
+  WalkableIndex walkable;
+  dungeon::init_walkable_index(dd, walkable);
+  // background is a single component, tiles show up as they're explored
+  TileMap tileMap{w, h, 0, std::vector<uint8_t>(w * h, bg_unexplored)};
+  const Texture2D atlas = tilemap::load_atlas({{nullptr, Color{125, 125, 125, 255}}, {"assets/floor.png"}, {"assets/wall.png"}},
+                                              tileMap.cellSize);
+  for (size_t i = 0; i < w * h; ++i)
+    if (dd.tilesExplore[i] == dungeon::explored)
+      tileMap.ids[i] = background_cell(map.tiles[i]);
   ecs.entity("dungeon")
-    .set(DungeonData{dungeonData, dungeonDataTilesExplore, w, h});
-
-  for (size_t y = 0; y < h; ++y)
-    for (size_t x = 0; x < w; ++x)
-    {
-      char tile = tiles[y * w + x];
-      // flecs::entity tileEntity = ecs.entity()
-      //   .add<BackgroundTile>()
-      //   .set(Position{int(x), int(y)})
-      //   .set(Color{255, 255, 255, 255});
-      // if (tile == dungeon::wall)
-      //   tileEntity.add<TextureSource>(wallTex);
-      // else if (tile == dungeon::floor)
-      //   tileEntity.add<TextureSource>(floorTex);
-      flecs::entity tileEntity = ecs.entity()
-        .add<BackgroundTile>()
-        .set(Position{int(x), int(y)})
-        .set(Color{125, 125, 125, 255});
+    .set(dd)
+    .set(frontier)
+    .set(walkable)
+    .set(std::move(tileMap))
+    .set(Texture2D{atlas});
+}
 
-    }
+uint8_t background_cell(char tile)
+{
+  if (tile == dungeon::floor)
+    return bg_floor;
+  if (tile == dungeon::wall)
+    return bg_wall;
+  return bg_unexplored;
 }
 
 
@@ -436,18 +474,14 @@ static void process_actions(flecs::world &ecs)
   static auto processActions = ecs.query<Action, Position, MovePos, const MeleeDamage, const Team>();
   static auto processHeals = ecs.query<Action, Hitpoints>();
   static auto checkAttacks = ecs.query<const MovePos, Hitpoints, const Team>();
-  static auto playerQuery = ecs.query<const IsPlayer, Action, NextExplorePos>();
+  static auto playerQuery = ecs.query<const IsPlayer, Action>();
 
-  playerQuery.each([&](const IsPlayer &, Action &act, NextExplorePos &nextPos)
+  playerQuery.each([&](const IsPlayer &, Action &act)
   {
     if (act.action == EA_AUTO_EXPLORE)
     {
       next_player_auto_action(ecs);
     }
-    else
-    {
-      nextPos = NextExplorePos{-1, -1};
-    }
   });
   // Process all actions
   ecs.defer([&]
@@ -572,10 +606,8 @@ void process_turn(flecs::world &ecs)
   static auto behTreeUpdate = ecs.query<BehaviourTree, Blackboard>();
   static auto turnIncrementer = ecs.query<TurnCounter>();
 
-  std::vector<float> exploreMap;
-    dmaps::gen_explore_map(ecs, exploreMap);
-    ecs.entity("explore_map")
-      .set(DijkstraMapData{exploreMap});
+  if (dmaps::gen_maps(ecs, dmaps::DMAP_EXPLORE))
+    dmaps::invalidate_composites();
 
   // ecs.entity("explore_map").add<VisualiseMap>();
   
@@ -600,38 +632,11 @@ void process_turn(flecs::world &ecs)
       turnIncrementer.each([](TurnCounter &tc) { tc.count++; });
     }
     process_actions(ecs);
+    dungeon::refresh_occupancy(ecs);
 
-    std::vector<float> approachMap;
-    dmaps::gen_player_approach_map(ecs, approachMap);
-    ecs.entity("approach_map")
-      .set(DijkstraMapData{approachMap});
-
-    std::vector<float> fleeMap;
-    dmaps::gen_player_flee_map(ecs, fleeMap);
-    ecs.entity("flee_map")
-      .set(DijkstraMapData{fleeMap});
-
-    std::vector<float> hiveMap;
-    dmaps::gen_hive_pack_map(ecs, hiveMap);
-    ecs.entity("hive_map")
-      .set(DijkstraMapData{hiveMap});
-
-    std::vector<float> magicianMap;
-    dmaps::gen_magician_map(ecs, magicianMap);
-    ecs.entity("magician_map")
-      .set(DijkstraMapData{magicianMap});
-
-    std::vector<float> teammateMap;
-    dmaps::gen_teamamte_map(ecs, teammateMap);
-    ecs.entity("teammate_map")
-      .set(DijkstraMapData{teammateMap});
-
-    ecs.entity("hive_follower_sum")
-      .set(DmapWeights{{{"magician_map", {1.f, 1.f}}}})
-      .add<VisualiseMap>();
-    // ecs.entity("hive_follower_sum")
-    //   .set(DmapWeights{{{"hive_map", {1.f, 1.f}}, {"approach_map", {1.8f, 0.8f}}}})
-    //   .add<VisualiseMap>();
+    if (dmaps::gen_maps(ecs, dmaps::DMAP_APPROACH | dmaps::DMAP_FLEE | dmaps::DMAP_HIVE |
+                             dmaps::DMAP_MAGICIAN | dmaps::DMAP_TEAMMATE))
+      dmaps::invalidate_composites();
   }
 }
 
@@ -1,10 +1,23 @@
 #pragma once
 
+#include <cstdint>
 #include <flecs.h>
+#include "dungeonFile.h"
+#include "rng.h"
 
 constexpr float tile_size = 512.f;
 
-void init_roguelike(flecs::world &ecs);
-void init_dungeon(flecs::world &ecs, char *tiles, char *tilesExplore, size_t w, size_t h);
+// cells of the background atlas
+enum BackgroundCell : uint8_t
+{
+  bg_unexplored = 0,
+  bg_floor,
+  bg_wall,
+};
+
+void init_roguelike(flecs::world &ecs, rng::Rng &rng);
+void init_dungeon(flecs::world &ecs, const mapfile::Dungeon &map);
 void process_turn(flecs::world &ecs);
+// background cell of an explored tile
+uint8_t background_cell(char tile);
 void print_stats(flecs::world &ecs);
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef> // size_t
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Read-only tiles that either own their memory or point into memory kept alive by an owner,
+// like a mapped dungeon file. Copies share the memory, components holding them copy cheaply.
+class TileBuffer
+{
+public:
+  TileBuffer() = default;
+
+  explicit TileBuffer(std::vector<char> tiles)
+  {
+    auto owned = std::make_shared<const std::vector<char>>(std::move(tiles));
+    ptr = owned->data();
+    count = owned->size();
+    storage = std::move(owned);
+  }
+
+  TileBuffer(std::shared_ptr<const void> owner, const char *tiles, size_t size)
+    : storage(std::move(owner)), ptr(tiles), count(size)
+  {
+  }
+
+  char operator[](size_t i) const { return ptr[i]; }
+  const char *data() const { return ptr; }
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+
+private:
+  std::shared_ptr<const void> storage;
+  const char *ptr = nullptr;
+  size_t count = 0;
+};
@@ -0,0 +1,21 @@
+#pragma once
+#include <vector>
+#include "raylib.h"
+#include "ecsTypes.h"
+
+namespace tilemap
+{
+  // an image scaled to the cell and tinted with color, no path makes a cell of plain color
+  struct AtlasCell
+  {
+    const char *path = nullptr;
+    Color color = WHITE;
+  };
+
+  // cells side by side in one texture, square ones the size of the tallest image
+  Texture2D load_atlas(const std::vector<AtlasCell> &cells, int &cell_size);
+
+  // Quads of tiles the camera sees, all from the atlas so raylib batches them together, the
+  // cost follows the screen and not the map. Without a camera the whole map is drawn.
+  void draw(const TileMap &map, const Texture2D &atlas, float tile_size, const Camera2D *camera);
+};
@@ -0,0 +1,159 @@
+#include "dmapComposite.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <unordered_map>
+
+constexpr float invalid_tile_value = 1e5f;
+
+static float as_float(uint32_t bits)
+{
+  float res;
+  memcpy(&res, &bits, sizeof(res));
+  return res;
+}
+
+static uint32_t as_bits(float v)
+{
+  uint32_t res;
+  memcpy(&res, &v, sizeof(res));
+  return res;
+}
+
+// bitwise select, with default fp trapping rules the compiler won't turn a ?: on floats
+// into a blend when one of the sides is arithmetic, so loops with it don't get vectorized
+static inline float select(bool cond, float a, float b)
+{
+  const uint32_t mask = 0u - uint32_t(cond);
+  return as_float((as_bits(a) & mask) | (as_bits(b) & ~mask));
+}
+
+// log2 for positive normal x, mantissa is folded into [sqrt(0.5), sqrt(2)) and the
+// atanh series is used there, error is well below float precision
+static inline float log2_positive(float x)
+{
+  const uint32_t bits = as_bits(x);
+  const int32_t exponent = int32_t(bits >> 23) - 127;
+  const float m = as_float((bits & 0x7fffffu) | 0x3f800000u);
+  const bool fold = m > 1.41421356f;
+  const float mf = select(fold, m * 0.5f, m);
+  const float t = (mf - 1.f) / (mf + 1.f);
+  const float t2 = t * t;
+  const float series = t * (2.f + t2 * (2.f / 3.f + t2 * (2.f / 5.f + t2 * (2.f / 7.f + t2 * (2.f / 9.f)))));
+  return float(exponent + int32_t(fold)) + series * 1.44269504f;
+}
+
+// 2^y, split into integer and [-0.5, 0.5] parts, Taylor series for the fraction
+static inline float exp2_clamped(float y)
+{
+  y = select(y < -126.f, -126.f, select(y > 127.f, 127.f, y));
+  // bias keeps the truncating conversion a floor, and it's a plain cvttps for sse2
+  const int32_t rounded = int32_t(y + 128.5f) - 128;
+  const float f = (y - float(rounded)) * 0.693147181f;
+  const float e = 1.f + f * (1.f + f * (1.f / 2.f + f * (1.f / 6.f + f * (1.f / 24.f +
+                  f * (1.f / 120.f + f * (1.f / 720.f + f * (1.f / 5040.f)))))));
+  return e * as_float(uint32_t(rounded + 127) << 23);
+}
+
+void dmaps::accumulate_weighted(float *sum, const float *map, size_t count, float mult, float pow)
+{
+  if (pow == 1.f)
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      const float v = map[i];
+      sum[i] += select(v < invalid_tile_value, v * mult, v);
+    }
+    return;
+  }
+  if (pow == std::floor(pow))
+  {
+    // negative bases are only defined for integer powers, leave those to powf
+    for (size_t i = 0; i < count; ++i)
+      sum[i] += map[i] < invalid_tile_value ? powf(map[i] * mult, pow) : map[i];
+    return;
+  }
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  for (size_t i = 0; i < count; ++i)
+  {
+    const float v = map[i];
+    const float x = v * mult;
+    const float p = exp2_clamped(pow * log2_positive(select(x > 1e-30f, x, 1e-30f)));
+    const float w = select(x > 0.f, p, select(x == 0.f, 0.f, nan));
+    sum[i] += select(v < invalid_tile_value, w, v);
+  }
+}
+
+struct Composite
+{
+  std::vector<float> map;
+  size_t generation = 0;
+};
+
+static size_t generation = 1;
+static std::unordered_map<std::string, size_t> profileIds;
+static std::vector<Composite> composites;
+
+void dmaps::compile_weights(flecs::world &ecs, const DmapWeights &wt, CompiledDmapWeights &cw)
+{
+  // sorted by name, so the same weights always make the same key
+  std::vector<const std::pair<const std::string, DmapWeights::WtData> *> sorted;
+  for (const auto &pair : wt.weights)
+    sorted.push_back(&pair);
+  std::sort(sorted.begin(), sorted.end(), [](auto a, auto b) { return a->first < b->first; });
+  std::string key;
+  cw.clear();
+  for (const auto *pair : sorted)
+  {
+    CompiledDmapWeights::Entry &entry = cw.add();
+    entry.map = ecs.entity(pair->first.c_str());
+    entry.mult = pair->second.mult;
+    entry.pow = pair->second.pow;
+    key.append(pair->first);
+    key.push_back('\0');
+    key.append(reinterpret_cast<const char *>(&entry.mult), sizeof(float));
+    key.append(reinterpret_cast<const char *>(&entry.pow), sizeof(float));
+  }
+  const auto [it, inserted] = profileIds.try_emplace(key, composites.size());
+  if (inserted)
+    composites.emplace_back();
+  cw.profile = it->second;
+}
+
+bool dmaps::is_resolved(const CompiledDmapWeights &cw)
+{
+  for (size_t i = 0; i < cw.count; ++i)
+    if (!cw[i].map.is_alive())
+      return false;
+  return true;
+}
+
+const std::vector<float> &dmaps::get_composite(const CompiledDmapWeights &cw)
+{
+  Composite &composite = composites[cw.profile];
+  if (composite.generation == generation)
+    return composite.map;
+  composite.generation = generation;
+  composite.map.clear();
+  for (size_t i = 0; i < cw.count; ++i)
+  {
+    const CompiledDmapWeights::Entry &entry = cw[i];
+    entry.map.get([&](const DijkstraMapData &dmap)
+    {
+      if (composite.map.empty())
+        composite.map.assign(dmap.map.size(), 0.f);
+      accumulate_weighted(composite.map.data(), dmap.map.data(),
+                          std::min(composite.map.size(), dmap.map.size()),
+                          entry.mult, entry.pow);
+    });
+  }
+  return composite.map;
+}
+
+void dmaps::invalidate_composites()
+{
+  ++generation;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef> // size_t
+#include <vector>
+#include <flecs.h>
+#include "ecsTypes.h"
+
+namespace dmaps
+{
+  // sum[i] += map[i] < 1e5 ? pow(map[i] * mult, pow) : map[i], in a loop the compiler can vectorize
+  void accumulate_weighted(float *sum, const float *map, size_t count, float mult, float pow);
+
+  // resolves map names once, followers and visualisation only use the compiled form
+  void compile_weights(flecs::world &ecs, const DmapWeights &wt, CompiledDmapWeights &cw);
+  // false if one of the map entities was deleted since and weights need to be compiled again
+  bool is_resolved(const CompiledDmapWeights &cw);
+
+  // all weights of a profile summed into one map, built on first use
+  // after maps were regenerated, empty if no map is there yet
+  const std::vector<float> &get_composite(const CompiledDmapWeights &cw);
+  // maps changed, composites are rebuilt lazily
+  void invalidate_composites();
+};
@@ -1,37 +1,34 @@
 #include "ecsTypes.h"
 #include "dmapFollower.h"
-#include <cmath>
+#include "dmapComposite.h"
+
+// composite already has weights applied, it's just five loads
+static void add_composite(float *moveWeights, const std::vector<float> &composite, const DungeonData &dd, const Position &pos)
+{
+  if (composite.empty())
+    return;
+  moveWeights[EA_NOP]         += composite[(pos.y+0) * dd.width + pos.x+0];
+  moveWeights[EA_MOVE_LEFT]   += composite[(pos.y+0) * dd.width + pos.x-1];
+  moveWeights[EA_MOVE_RIGHT]  += composite[(pos.y+0) * dd.width + pos.x+1];
+  moveWeights[EA_MOVE_UP]     += composite[(pos.y-1) * dd.width + pos.x+0];
+  moveWeights[EA_MOVE_DOWN]   += composite[(pos.y+1) * dd.width + pos.x+0];
+}
 
 void process_dmap_followers(flecs::world &ecs)
 {
-  static auto processDmapFollowers = ecs.query<const Position, Action, const DmapWeights>();
+  static auto processDmapFollowers = ecs.query<const Position, Action, const DmapWeights, CompiledDmapWeights>();
   static auto dungeonDataQuery = ecs.query<const DungeonData>();
 
-  auto get_dmap_at = [&](const DijkstraMapData &dmap, const DungeonData &dd, size_t x, size_t y, float mult, float pow)
-  {
-    const float v = dmap.map[y * dd.width + x];
-    if (v < 1e5f)
-      return powf(v * mult, pow);
-    return v;
-  };
   dungeonDataQuery.each([&](const DungeonData &dd)
   {
-    processDmapFollowers.each([&](const Position &pos, Action &act, const DmapWeights &wt)
+    processDmapFollowers.each([&](const Position &pos, Action &act, const DmapWeights &wt, CompiledDmapWeights &cw)
     {
       float moveWeights[EA_MOVE_END];
       for (size_t i = 0; i < EA_MOVE_END; ++i)
         moveWeights[i] = 0.f;
-      for (const auto &pair : wt.weights)
-      {
-        ecs.entity(pair.first.c_str()).get([&](const DijkstraMapData &dmap)
-        {
-          moveWeights[EA_NOP]         += get_dmap_at(dmap, dd, pos.x+0, pos.y+0, pair.second.mult, pair.second.pow);
-          moveWeights[EA_MOVE_LEFT]   += get_dmap_at(dmap, dd, pos.x-1, pos.y+0, pair.second.mult, pair.second.pow);
-          moveWeights[EA_MOVE_RIGHT]  += get_dmap_at(dmap, dd, pos.x+1, pos.y+0, pair.second.mult, pair.second.pow);
-          moveWeights[EA_MOVE_UP]     += get_dmap_at(dmap, dd, pos.x+0, pos.y-1, pair.second.mult, pair.second.pow);
-          moveWeights[EA_MOVE_DOWN]   += get_dmap_at(dmap, dd, pos.x+0, pos.y+1, pair.second.mult, pair.second.pow);
-        });
-      }
+      if (!dmaps::is_resolved(cw))
+        dmaps::compile_weights(ecs, wt, cw);
+      add_composite(moveWeights, dmaps::get_composite(cw), dd, pos);
       float minWt = moveWeights[EA_NOP];
       for (size_t i = 0; i < EA_MOVE_END; ++i)
         if (moveWeights[i] < minWt)
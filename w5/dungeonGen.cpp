@@ -2,36 +2,18 @@
 #include "dungeonUtils.h"
 #include <cstring> // memset
 #include <cstdio> // printf
-#include <random>
-#include <chrono> // std::chrono
-#include <functional> // std::bind
 #include "ecsTypes.h"
 #include "math.h"
 #include <limits>
 
 
-void gen_drunk_dungeon(char *tiles, size_t w, size_t h)
+void gen_drunk_dungeon(char *tiles, size_t w, size_t h, rng::Rng &rng)
 {
   //constexpr char wall = '#';
   //constexpr char flr = ' ';
 
   memset(tiles, dungeon::wall, w * h);
 
-  // generator
-  unsigned seed = unsigned(std::chrono::system_clock::now().time_since_epoch().count() % std::numeric_limits<int>::max());
-  std::default_random_engine seedGenerator(seed);
-  std::default_random_engine widthGenerator(seedGenerator());
-  std::default_random_engine heightGenerator(seedGenerator());
-  std::default_random_engine dirGenerator(seedGenerator());
-
-  // distributions
-  std::uniform_int_distribution<size_t> widthDist(1, w-2);
-  std::uniform_int_distribution<size_t> heightDist(1, h-2);
-  std::uniform_int_distribution<size_t> dirDist(0, 3);
-  auto rndWd = std::bind(widthDist, widthGenerator);
-  auto rndHt = std::bind(heightDist, heightGenerator);
-  auto rndDir = std::bind(dirDist, dirGenerator);
-
   const int dirs[4][2] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1}};
 
   constexpr size_t numIter = 4;
@@ -40,8 +22,8 @@ void gen_drunk_dungeon(char *tiles, size_t w, size_t h)
   for (size_t iter = 0; iter < numIter; ++iter)
   {
     // select random point on map
-    size_t x = rndWd();
-    size_t y = rndHt();
+    size_t x = size_t(rng.range(1, int(w) - 2));
+    size_t y = size_t(rng.range(1, int(h) - 2));
     startPos.push_back({int(x), int(y)});
     size_t numExcavations = 0;
     while (numExcavations < maxExcavations)
@@ -52,7 +34,7 @@ void gen_drunk_dungeon(char *tiles, size_t w, size_t h)
         tiles[y * w + x] = dungeon::floor;
       }
       // choose random dir
-      size_t dir = rndDir(); // 0 - right, 1 - up, 2 - left, 3 - down
+      size_t dir = size_t(rng.range(0, 3)); // 0 - right, 1 - up, 2 - left, 3 - down
       int newX = std::min(std::max(int(x) + dirs[dir][0], 1), int(w) - 2);
       int newY = std::min(std::max(int(y) + dirs[dir][1], 1), int(h) - 2);
       x = size_t(newX);
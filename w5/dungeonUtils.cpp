@@ -1,25 +1,90 @@
 #include "dungeonUtils.h"
 #include "raylib.h"
 
-Position dungeon::find_walkable_tile(flecs::world &ecs)
+void dungeon::init_walkable_index(const DungeonData &dd, WalkableIndex &index)
 {
-  static auto dungeonDataQuery = ecs.query<const DungeonData>();
+  index = WalkableIndex{};
+  for (size_t idx = 0; idx < dd.width * dd.height; ++idx)
+    if (dd.tiles[idx] == dungeon::floor)
+      index.tiles.push_back(uint32_t(idx));
+  index.occupied.assign((dd.width * dd.height + 63) / 64, 0);
+}
+
+Position dungeon::find_walkable_tile(flecs::world &ecs, rng::Rng &rng)
+{
+  static auto dungeonDataQuery = ecs.query<const DungeonData, const WalkableIndex>();
 
   Position res{0, 0};
-  dungeonDataQuery.each([&](const DungeonData &dd)
+  dungeonDataQuery.each([&](const DungeonData &dd, const WalkableIndex &index)
   {
-    // prebuild all walkable and get one of them
-    std::vector<Position> posList;
-    for (size_t y = 0; y < dd.height; ++y)
-      for (size_t x = 0; x < dd.width; ++x)
-        if (dd.tiles[y * dd.width + x] == dungeon::floor)
-          posList.push_back(Position{int(x), int(y)});
-    size_t rndIdx = size_t(GetRandomValue(0, int(posList.size()) - 1));
-    res = posList[rndIdx];
+    if (index.tiles.empty())
+      return;
+    const uint32_t idx = index.tiles[rng.index(index.tiles.size())];
+    res = Position{int(idx % dd.width), int(idx / dd.width)};
   });
   return res;
 }
 
+static bool is_occupied(const WalkableIndex &index, uint32_t idx)
+{
+  return (index.occupied[idx / 64] >> (idx % 64)) & 1;
+}
+
+static void occupy(WalkableIndex &index, uint32_t idx)
+{
+  if (is_occupied(index, idx))
+    return;
+  index.occupied[idx / 64] |= uint64_t(1) << (idx % 64);
+  index.occupiedTiles.push_back(idx);
+}
+
+Position dungeon::find_free_tile(flecs::world &ecs, rng::Rng &rng)
+{
+  static auto dungeonDataQuery = ecs.query<const DungeonData, WalkableIndex>();
+
+  Position res{0, 0};
+  dungeonDataQuery.each([&](const DungeonData &dd, WalkableIndex &index)
+  {
+    if (index.tiles.empty())
+      return;
+    uint32_t idx = index.tiles[rng.index(index.tiles.size())];
+    // a few picks almost always find a free tile, the free ones are only listed for crowded dungeons
+    for (int attempt = 1; attempt < 16 && is_occupied(index, idx); ++attempt)
+      idx = index.tiles[rng.index(index.tiles.size())];
+    if (is_occupied(index, idx))
+    {
+      std::vector<uint32_t> freeTiles;
+      for (uint32_t tile : index.tiles)
+        if (!is_occupied(index, tile))
+          freeTiles.push_back(tile);
+      // when everything is taken creatures have to share
+      if (!freeTiles.empty())
+        idx = freeTiles[rng.index(freeTiles.size())];
+    }
+    occupy(index, idx);
+    res = Position{int(idx % dd.width), int(idx / dd.width)};
+  });
+  return res;
+}
+
+void dungeon::refresh_occupancy(flecs::world &ecs)
+{
+  static auto dungeonDataQuery = ecs.query<const DungeonData, WalkableIndex>();
+  static auto creaturesQuery = ecs.query<const Position, const Hitpoints>();
+
+  dungeonDataQuery.each([&](const DungeonData &dd, WalkableIndex &index)
+  {
+    for (uint32_t idx : index.occupiedTiles)
+      index.occupied[idx / 64] &= ~(uint64_t(1) << (idx % 64));
+    index.occupiedTiles.clear();
+    creaturesQuery.each([&](const Position &pos, const Hitpoints &)
+    {
+      if (pos.x >= 0 && pos.y >= 0 && pos.x < int(dd.width) && pos.y < int(dd.height))
+        occupy(index, uint32_t(size_t(pos.y) * dd.width + size_t(pos.x)));
+    });
+  });
+}
+
 bool dungeon::is_tile_walkable(flecs::world &ecs, Position pos)
 {
   static auto dungeonDataQuery = ecs.query<const DungeonData>();
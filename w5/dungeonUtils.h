@@ -1,12 +1,20 @@
 #pragma once
 #include "ecsTypes.h"
 #include <flecs.h>
+#include "rng.h"
 
 namespace dungeon
 {
   constexpr char wall = '#';
   constexpr char floor = ' ';
 
-  Position find_walkable_tile(flecs::world &ecs);
+  // floor tiles are listed once when the dungeon is made
+  void init_walkable_index(const DungeonData &dd, WalkableIndex &index);
+  Position find_walkable_tile(flecs::world &ecs, rng::Rng &rng);
+  // random floor without a creature on it, expected O(1) while most of the floor is free,
+  // it's marked occupied right away so spawns in a row don't get the same tile
+  Position find_free_tile(flecs::world &ecs, rng::Rng &rng);
+  // occupancy from where creatures are now, after they moved or died
+  void refresh_occupancy(flecs::world &ecs);
   bool is_tile_walkable(flecs::world &ecs, Position pos);
 };
@@ -3,6 +3,8 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <flecs.h>
+#include "tileBuffer.h"
 
 // TODO: make a lot of seprate files
 struct Position;
@@ -136,15 +138,32 @@ struct ActionLog
   size_t capacity = 5;
 };
 
-struct BackgroundTile {};
+// background of the whole map, an atlas cell for every tile, the atlas is a Texture2D
+// on the same entity
+struct TileMap
+{
+  size_t width = 0;
+  size_t height = 0;
+  int cellSize = 0; // of the atlas, in pixels
+  std::vector<uint8_t> ids;
+};
 
 struct DungeonData
 {
-  std::vector<char> tiles; // for pathfinding
+  TileBuffer tiles; // for pathfinding, can point into a mapped dungeon file
   size_t width;
   size_t height;
 };
 
+// floor tiles in a list to pick a random one in O(1), one bit per tile for the ones a creature
+// stands on, set bits are also listed so they're cleared without going over the whole map
+struct WalkableIndex
+{
+  std::vector<uint32_t> tiles;
+  std::vector<uint64_t> occupied;
+  std::vector<uint32_t> occupiedTiles;
+};
+
 struct DijkstraMapData
 {
   std::vector<float> map;
@@ -162,4 +181,38 @@ struct DmapWeights
   std::unordered_map<std::string, WtData> weights;
 };
 
+// DmapWeights with map names resolved to entities, kept up to date by an OnSet observer
+struct CompiledDmapWeights
+{
+  // most profiles fit in place, entries past these go to overflow
+  static constexpr size_t inline_maps = 4;
+  struct Entry
+  {
+    flecs::entity map;
+    float mult = 1.f;
+    float pow = 1.f;
+  };
+  Entry entries[inline_maps];
+  std::vector<Entry> overflow;
+  size_t count = 0;
+  // weights with the same contents share a profile and a composite map
+  size_t profile = 0;
+
+  Entry &operator[](size_t i) { return i < inline_maps ? entries[i] : overflow[i - inline_maps]; }
+  const Entry &operator[](size_t i) const { return i < inline_maps ? entries[i] : overflow[i - inline_maps]; }
+
+  Entry &add()
+  {
+    if (count++ < inline_maps)
+      return entries[count - 1] = Entry{};
+    return overflow.emplace_back();
+  }
+
+  void clear()
+  {
+    count = 0;
+    overflow.clear();
+  }
+};
+
 struct Hive {};
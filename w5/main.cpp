@@ -1,7 +1,11 @@
 //
 #include "raylib.h"
 #include <flecs.h>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
 #include <algorithm>
+#include <random>
 #include "ecsTypes.h"
 #include "roguelike.h"
 #include "dungeonGen.h"
@@ -193,19 +197,27 @@ static void debug_looter_planner()
 }
 
 
-static void update_camera(Camera2D &cam, flecs::world &ecs)
+static void update_camera(flecs::world &ecs)
 {
+  static auto cameraQuery = ecs.query<Camera2D>();
   static auto playerQuery = ecs.query<const Position, const IsPlayer>();
 
-  playerQuery.each([&](const Position &pos, const IsPlayer &)
+  cameraQuery.each([&](Camera2D &cam)
   {
-    cam.target.x += (pos.x * tile_size - cam.target.x) * 0.1f;
-    cam.target.y += (pos.y * tile_size - cam.target.y) * 0.1f;
+    playerQuery.each([&](const Position &pos, const IsPlayer &)
+    {
+      cam.target.x += (pos.x * tile_size - cam.target.x) * 0.1f;
+      cam.target.y += (pos.y * tile_size - cam.target.y) * 0.1f;
+    });
   });
 }
 
-int main(int /*argc*/, const char ** /*argv*/)
+int main(int argc, const char **argv)
 {
+  // pass a seed to replay the same dungeon and the same random decisions
+  const uint64_t seed = argc > 1 ? strtoull(argv[1], nullptr, 10) : std::random_device{}();
+  printf("seed %" PRIu64 "\n", seed);
+  rng::Rng rng(seed);
   int width = 1920;
   int height = 1080;
   InitWindow(width, height, "w3 AI MIPT");
@@ -221,13 +233,26 @@ int main(int /*argc*/, const char ** /*argv*/)
 
   flecs::world ecs;
   {
-    constexpr size_t dungWidth = 50;
-    constexpr size_t dungHeight = 50;
-    char *tiles = new char[dungWidth * dungHeight];
-    gen_drunk_dungeon(tiles, dungWidth, dungHeight);
-    init_dungeon(ecs, tiles, dungWidth, dungHeight);
+    // a map file after the seed is loaded when it's there, a new dungeon is saved to it otherwise,
+    // the dungeon has a stream of its own, so the game goes the same way either way
+    rng::Rng dungeonRng = rng.split();
+    mapfile::Dungeon map;
+    if (argc <= 2 || !mapfile::load(argv[2], map))
+    {
+      constexpr size_t dungWidth = 50;
+      constexpr size_t dungHeight = 50;
+      std::vector<char> tiles(dungWidth * dungHeight);
+      gen_drunk_dungeon(tiles.data(), dungWidth, dungHeight, dungeonRng);
+      map.info = mapfile::Info{dungWidth, dungHeight, seed, "drunk"};
+      if (argc > 2)
+        mapfile::save(argv[2], map.info, tiles.data(), nullptr, mapfile::Encoding::raw);
+      map.tiles = TileBuffer(std::move(tiles));
+    }
+    else if (map.info.seed != seed)
+      printf("%s was made with seed %" PRIu64 "\n", argv[2], map.info.seed);
+    init_dungeon(ecs, map);
   }
-  init_roguelike(ecs);
+  init_roguelike(ecs, rng);
   //debug_enemy_planner();
   debug_looter_planner();
 
@@ -236,16 +261,20 @@ int main(int /*argc*/, const char ** /*argv*/)
   camera.offset = Vector2{ width * 0.5f, height * 0.5f };
   camera.rotation = 0.f;
   camera.zoom = 0.125f;
+  // the background only draws tiles the camera sees
+  ecs.entity("camera")
+    .set(Camera2D{camera});
 
   SetTargetFPS(60);               // Set our game to run at 60 frames-per-second
   while (!WindowShouldClose())
   {
+    static auto cameraQuery = ecs.query<Camera2D>();
     process_turn(ecs);
-    update_camera(camera, ecs);
+    update_camera(ecs);
 
     BeginDrawing();
       ClearBackground(BLACK);
-      BeginMode2D(camera);
+      cameraQuery.each([&](Camera2D &cam) { BeginMode2D(cam); });
         ecs.progress();
       EndMode2D();
       print_stats(ecs);
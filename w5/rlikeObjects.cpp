@@ -9,28 +9,9 @@ flecs::entity create_hive(flecs::entity e)
   return e;
 }
 
-static Position find_free_dungeon_tile(flecs::world &ecs)
+flecs::entity create_monster(flecs::world &ecs, rng::Rng &rng, Color col, const char *texture_src)
 {
-  static auto findMonstersQuery = ecs.query<const Position, const Hitpoints>();
-  bool done = false;
-  while (!done)
-  {
-    done = true;
-    Position pos = dungeon::find_walkable_tile(ecs);
-    findMonstersQuery.each([&](const Position &p, const Hitpoints&)
-    {
-      if (p == pos)
-        done = false;
-    });
-    if (done)
-      return pos;
-  };
-  return {0, 0};
-}
-
-flecs::entity create_monster(flecs::world &ecs, Color col, const char *texture_src)
-{
-  Position pos = find_free_dungeon_tile(ecs);
+  Position pos = dungeon::find_free_tile(ecs, rng);
 
   flecs::entity textureSrc = ecs.entity(texture_src);
   return ecs.entity()
@@ -43,12 +24,13 @@ flecs::entity create_monster(flecs::world &ecs, Color col, const char *texture_s
     .set(Team{1})
     .set(NumActions{1, 0})
     .set(MeleeDamage{20.f})
-    .set(Blackboard{});
+    .set(Blackboard{})
+    .set(rng.split()); // own stream for its random moves
 }
 
-void create_player(flecs::world &ecs, const char *texture_src)
+void create_player(flecs::world &ecs, rng::Rng &rng, const char *texture_src)
 {
-  Position pos = find_free_dungeon_tile(ecs);
+  Position pos = dungeon::find_free_tile(ecs, rng);
 
   flecs::entity textureSrc = ecs.entity(texture_src);
   ecs.entity("player")
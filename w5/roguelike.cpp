@@ -6,8 +6,10 @@
 #include "blackboard.h"
 #include "math.h"
 #include "dungeonUtils.h"
+#include "tileMap.h"
 #include "dijkstraMapGen.h"
 #include "dmapFollower.h"
+#include "dmapComposite.h"
 #include "dmapBeh.h"
 #include "rlikeObjects.h"
 
@@ -35,15 +37,13 @@ static void register_roguelike_systems(flecs::world &ecs)
       inp.up = up;
       inp.down = down;
     });
-  ecs.system<const Position, const Color>()
-    .term<TextureSource>(flecs::Wildcard)
-    .term<BackgroundTile>()
-    .each([&](flecs::entity e, const Position &pos, const Color color)
+  static auto cameraQuery = ecs.query<const Camera2D>();
+  ecs.system<const TileMap, const Texture2D>()
+    .each([&](const TileMap &map, const Texture2D &atlas)
     {
-      const auto textureSrc = e.target<TextureSource>();
-      DrawTextureQuad(*textureSrc.get<Texture2D>(),
-          Vector2{1, 1}, Vector2{0, 0},
-          Rectangle{float(pos.x) * tile_size, float(pos.y) * tile_size, tile_size, tile_size}, color);
+      const Camera2D *camera = nullptr;
+      cameraQuery.each([&](const Camera2D &cam) { camera = &cam; });
+      tilemap::draw(map, atlas, tile_size, camera);
     });
   ecs.system<const Position, const Color>()
     .term<TextureSource>(flecs::Wildcard).not_()
@@ -54,7 +54,6 @@ static void register_roguelike_systems(flecs::world &ecs)
     });
   ecs.system<const Position, const Color>()
     .term<TextureSource>(flecs::Wildcard)
-    .term<BackgroundTile>().not_()
     .each([&](flecs::entity e, const Position &pos, const Color color)
     {
       const auto textureSrc = e.target<TextureSource>();
@@ -80,29 +79,21 @@ static void register_roguelike_systems(flecs::world &ecs)
     {
       SetTextureFilter(tex, TEXTURE_FILTER_POINT);
     });
-  ecs.system<const DmapWeights>()
+  ecs.system<const CompiledDmapWeights>()
     .term<VisualiseMap>()
-    .each([&](const DmapWeights &wt)
+    .each([&](const CompiledDmapWeights &cw)
     {
       dungeonDataQuery.each([&](const DungeonData &dd)
       {
+        const std::vector<float> &sum = dmaps::get_composite(cw);
+        if (sum.size() < dd.width * dd.height)
+          return;
         for (size_t y = 0; y < dd.height; ++y)
           for (size_t x = 0; x < dd.width; ++x)
           {
-            float sum = 0.f;
-            for (const auto &pair : wt.weights)
-            {
-              ecs.entity(pair.first.c_str()).get([&](const DijkstraMapData &dmap)
-              {
-                float v = dmap.map[y * dd.width + x];
-                if (v < 1e5f)
-                  sum += powf(v * pair.second.mult, pair.second.pow);
-                else
-                  sum += v;
-              });
-            }
-            if (sum < 1e5f)
-              DrawText(TextFormat("%.1f", sum),
+            const float val = sum[y * dd.width + x];
+            if (val < 1e5f)
+              DrawText(TextFormat("%.1f", val),
                   int((float(x) + 0.2f) * tile_size), int((float(y) + 0.5f) * tile_size), 150, WHITE);
           }
       });
@@ -126,7 +117,7 @@ static void register_roguelike_systems(flecs::world &ecs)
 }
 
 
-void init_roguelike(flecs::world &ecs)
+void init_roguelike(flecs::world &ecs, rng::Rng &rng)
 {
   register_roguelike_systems(ecs);
 
@@ -135,6 +126,17 @@ void init_roguelike(flecs::world &ecs)
   ecs.entity("minotaur_tex")
     .set(Texture2D{LoadTexture("assets/minotaur.png")});
 
+  // compiled into a local first, adding the component moves the entity and wt with it
+  ecs.observer<const DmapWeights>()
+    .event(flecs::OnSet)
+    .each([](flecs::entity e, const DmapWeights &wt)
+    {
+      flecs::world ecs = e.world();
+      CompiledDmapWeights cw;
+      dmaps::compile_weights(ecs, wt, cw);
+      e.set(cw);
+    });
+
   ecs.observer<Texture2D>()
     .event(flecs::OnRemove)
     .each([](Texture2D texture)
@@ -142,46 +144,36 @@ void init_roguelike(flecs::world &ecs)
         UnloadTexture(texture);
       });
 
-  create_hive_monster(create_monster(ecs, Color{0xee, 0x00, 0xee, 0xff}, "minotaur_tex"));
-  create_hive_monster(create_monster(ecs, Color{0xee, 0x00, 0xee, 0xff}, "minotaur_tex"));
-  create_hive_monster(create_monster(ecs, Color{0x11, 0x11, 0x11, 0xff}, "minotaur_tex"));
-  create_hive(create_player_fleer(create_monster(ecs, Color{0, 255, 0, 255}, "minotaur_tex")));
+  create_hive_monster(create_monster(ecs, rng, Color{0xee, 0x00, 0xee, 0xff}, "minotaur_tex"));
+  create_hive_monster(create_monster(ecs, rng, Color{0xee, 0x00, 0xee, 0xff}, "minotaur_tex"));
+  create_hive_monster(create_monster(ecs, rng, Color{0x11, 0x11, 0x11, 0xff}, "minotaur_tex"));
+  create_hive(create_player_fleer(create_monster(ecs, rng, Color{0, 255, 0, 255}, "minotaur_tex")));
 
-  create_player(ecs, "swordsman_tex");
+  create_player(ecs, rng, "swordsman_tex");
 
   ecs.entity("world")
     .set(TurnCounter{})
     .set(ActionLog{});
 }
 
-void init_dungeon(flecs::world &ecs, char *tiles, size_t w, size_t h)
+void init_dungeon(flecs::world &ecs, const mapfile::Dungeon &map)
 {
-  flecs::entity wallTex = ecs.entity("wall_tex")
-    .set(Texture2D{LoadTexture("assets/wall.png")});
-  flecs::entity floorTex = ecs.entity("floor_tex")
-    .set(Texture2D{LoadTexture("assets/floor.png")});
-
-  std::vector<char> dungeonData;
-  dungeonData.resize(w * h);
-  for (size_t y = 0; y < h; ++y)
-    for (size_t x = 0; x < w; ++x)
-      dungeonData[y * w + x] = tiles[y * w + x];
+  const size_t w = map.info.width;
+  const size_t h = map.info.height;
+  // tiles are shared with the map, no copy when they're in a mapped file
+  const DungeonData dd{map.tiles, w, h};
+  WalkableIndex walkable;
+  dungeon::init_walkable_index(dd, walkable);
+  // background is a single component, cell 0 of the atlas is floor, 1 is wall
+  TileMap tileMap{w, h, 0, std::vector<uint8_t>(w * h, 0)};
+  const Texture2D atlas = tilemap::load_atlas({{"assets/floor.png"}, {"assets/wall.png"}}, tileMap.cellSize);
+  for (size_t i = 0; i < w * h; ++i)
+    tileMap.ids[i] = map.tiles[i] == dungeon::wall ? 1 : 0;
   ecs.entity("dungeon")
-    .set(DungeonData{dungeonData, w, h});
-
-  for (size_t y = 0; y < h; ++y)
-    for (size_t x = 0; x < w; ++x)
-    {
-      char tile = tiles[y * w + x];
-      flecs::entity tileEntity = ecs.entity()
-        .add<BackgroundTile>()
-        .set(Position{int(x), int(y)})
-        .set(Color{255, 255, 255, 255});
-      if (tile == dungeon::wall)
-        tileEntity.add<TextureSource>(wallTex);
-      else if (tile == dungeon::floor)
-        tileEntity.add<TextureSource>(floorTex);
-    }
+    .set(dd)
+    .set(walkable)
+    .set(std::move(tileMap))
+    .set(Texture2D{atlas});
 }
 
 
@@ -380,6 +372,7 @@ void process_turn(flecs::world &ecs)
       turnIncrementer.each([](TurnCounter &tc) { tc.count++; });
     }
     process_actions(ecs);
+    dungeon::refresh_occupancy(ecs);
 
     std::vector<float> approachMap;
     dmaps::gen_player_approach_map(ecs, approachMap);
@@ -395,6 +388,7 @@ void process_turn(flecs::world &ecs)
     dmaps::gen_hive_pack_map(ecs, hiveMap);
     ecs.entity("hive_map")
       .set(DijkstraMapData{hiveMap});
+    dmaps::invalidate_composites();
 
     //ecs.entity("flee_map").add<VisualiseMap>();
     ecs.entity("hive_follower_sum")
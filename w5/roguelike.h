@@ -1,10 +1,12 @@
 #pragma once
 
 #include <flecs.h>
+#include "dungeonFile.h"
+#include "rng.h"
 
 constexpr float tile_size = 512.f;
 
-void init_roguelike(flecs::world &ecs);
-void init_dungeon(flecs::world &ecs, char *tiles, size_t w, size_t h);
+void init_roguelike(flecs::world &ecs, rng::Rng &rng);
+void init_dungeon(flecs::world &ecs, const mapfile::Dungeon &map);
 void process_turn(flecs::world &ecs);
 void print_stats(flecs::world &ecs);
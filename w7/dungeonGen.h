@@ -1,4 +1,5 @@
 #pragma once
 #include <cstddef> // size_t
+#include "rng.h"
 
-void gen_drunk_dungeon(char *tiles, size_t w, size_t h);
+void gen_drunk_dungeon(char *tiles, size_t w, size_t h, rng::Rng &rng);
@@ -1,21 +1,25 @@
 #include "dungeonUtils.h"
 #include "raylib.h"
 
-Position dungeon::find_walkable_tile(flecs::world &ecs)
+void dungeon::init_walkable_index(const DungeonData &dd, WalkableIndex &index)
 {
-  static auto dungeonDataQuery = ecs.query<const DungeonData>();
+  index = WalkableIndex{};
+  for (size_t idx = 0; idx < dd.width * dd.height; ++idx)
+    if (dd.tiles[idx] == dungeon::floor)
+      index.tiles.push_back(uint32_t(idx));
+}
+
+Position dungeon::find_walkable_tile(flecs::world &ecs, rng::Rng &rng)
+{
+  static auto dungeonDataQuery = ecs.query<const DungeonData, const WalkableIndex>();
 
   Position res{0, 0};
-  dungeonDataQuery.each([&](const DungeonData &dd)
+  dungeonDataQuery.each([&](const DungeonData &dd, const WalkableIndex &index)
   {
-    // prebuild all walkable and get one of them
-    std::vector<Position> posList;
-    for (size_t y = 0; y < dd.height; ++y)
-      for (size_t x = 0; x < dd.width; ++x)
-        if (dd.tiles[y * dd.width + x] == dungeon::floor)
-          posList.push_back(Position{float(x), float(y)});
-    size_t rndIdx = size_t(GetRandomValue(0, int(posList.size()) - 1));
-    res = posList[rndIdx];
+    if (index.tiles.empty())
+      return;
+    const uint32_t idx = index.tiles[rng.index(index.tiles.size())];
+    res = Position{float(idx % dd.width), float(idx / dd.width)};
   });
   return res;
 }
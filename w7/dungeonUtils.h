@@ -1,12 +1,15 @@
 #pragma once
 #include "ecsTypes.h"
 #include <flecs.h>
+#include "rng.h"
 
 namespace dungeon
 {
   constexpr char wall = '#';
   constexpr char floor = ' ';
 
-  Position find_walkable_tile(flecs::world &ecs);
+  // floor tiles are listed once when the dungeon is made
+  void init_walkable_index(const DungeonData &dd, WalkableIndex &index);
+  Position find_walkable_tile(flecs::world &ecs, rng::Rng &rng);
   bool is_tile_walkable(flecs::world &ecs, Position pos);
 };
@@ -4,6 +4,7 @@
 #include <vector>
 #include <unordered_map>
 #include <math.h>
+#include "tileBuffer.h"
 
 // TODO: make a lot of seprate files
 struct Position
@@ -156,15 +157,29 @@ struct ActionLog
   size_t capacity = 5;
 };
 
-struct BackgroundTile {};
+// background of the whole map, an atlas cell for every tile, the atlas is a Texture2D
+// on the same entity
+struct TileMap
+{
+  size_t width = 0;
+  size_t height = 0;
+  int cellSize = 0; // of the atlas, in pixels
+  std::vector<uint8_t> ids;
+};
 
 struct DungeonData
 {
-  std::vector<char> tiles; // for pathfinding
+  TileBuffer tiles; // for pathfinding, can point into a mapped dungeon file
   size_t width;
   size_t height;
 };
 
+// floor tiles in a list to pick a random one in O(1)
+struct WalkableIndex
+{
+  std::vector<uint32_t> tiles;
+};
+
 struct DijkstraMapData
 {
   std::vector<float> map;
@@ -0,0 +1,260 @@
+#pragma once
+#include <cstddef> // size_t
+#include <cstdlib> // abs
+#include <cmath>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+// Grid search with connectivity, cost model and heuristic chosen at compile time,
+// so every combination gets its own fully unrolled and inlined inner loop.
+namespace grid
+{
+  constexpr float sqrt2 = 1.41421356f;
+
+  struct Neighbourhood4
+  {
+    static constexpr size_t count = 4;
+    static constexpr int dx[count] = {1, -1, 0, 0};
+    static constexpr int dy[count] = {0, 0, 1, -1};
+    static constexpr float len[count] = {1.f, 1.f, 1.f, 1.f};
+  };
+
+  struct Neighbourhood8
+  {
+    static constexpr size_t count = 8;
+    static constexpr int dx[count] = {1, -1, 0, 0, 1, -1, 1, -1};
+    static constexpr int dy[count] = {0, 0, 1, -1, 1, 1, -1, -1};
+    static constexpr float len[count] = {1.f, 1.f, 1.f, 1.f, sqrt2, sqrt2, sqrt2, sqrt2};
+  };
+
+  template<char Wall>
+  struct UniformCost
+  {
+    static constexpr bool passable(char tile) { return tile != Wall; }
+    static constexpr float cost(char) { return 1.f; }
+  };
+
+  // entering a Heavy tile costs HeavyCost instead of 1
+  template<char Wall, char Heavy, int HeavyCost>
+  struct WeightedCost
+  {
+    static constexpr bool passable(char tile) { return tile != Wall; }
+    static constexpr float cost(char tile) { return tile == Heavy ? float(HeavyCost) : 1.f; }
+  };
+
+  struct Manhattan
+  {
+    static float estimate(int dx, int dy) { return float(abs(dx) + abs(dy)); }
+  };
+
+  struct Octile
+  {
+    static float estimate(int dx, int dy)
+    {
+      const int ax = abs(dx);
+      const int ay = abs(dy);
+      return float(std::max(ax, ay)) + (sqrt2 - 1.f) * float(std::min(ax, ay));
+    }
+  };
+
+  struct Euclidean
+  {
+    static float estimate(int dx, int dy) { return sqrtf(float(dx * dx + dy * dy)); }
+  };
+
+  template<size_t... I, typename Callable>
+  inline void unroll(std::index_sequence<I...>, Callable &&c)
+  {
+    (c(std::integral_constant<size_t, I>{}), ...);
+  }
+
+  struct NoExpandCallback
+  {
+    void operator()(int, int, float) const {}
+  };
+
+  template<typename Neighbourhood, typename CostPolicy, typename Heuristic>
+  struct GridSearch
+  {
+    static constexpr size_t invalid_idx = std::numeric_limits<size_t>::max();
+
+    // calls c(neighbourIdx, nx, ny, stepLength) for every passable neighbour of (x, y) inside [min, max)
+    template<typename Callable>
+    static void for_each_neighbour(const char *tiles, size_t w, int x, int y,
+                                   int min_x, int min_y, int max_x, int max_y, Callable &&c)
+    {
+      unroll(std::make_index_sequence<Neighbourhood::count>{}, [&](auto i)
+      {
+        constexpr int dx = Neighbourhood::dx[i];
+        constexpr int dy = Neighbourhood::dy[i];
+        const int nx = x + dx;
+        const int ny = y + dy;
+        if (nx < min_x || ny < min_y || nx >= max_x || ny >= max_y)
+          return;
+        const char tile = tiles[size_t(ny) * w + size_t(nx)];
+        if (!CostPolicy::passable(tile))
+          return;
+        if constexpr (dx != 0 && dy != 0)
+        {
+          // don't cut corners
+          if (!CostPolicy::passable(tiles[size_t(y) * w + size_t(nx)]) ||
+              !CostPolicy::passable(tiles[size_t(ny) * w + size_t(x)]))
+            return;
+        }
+        c(size_t(ny) * w + size_t(nx), nx, ny, Neighbourhood::len[i]);
+      });
+    }
+
+    template<typename Vec>
+    static std::vector<Vec> reconstruct_path(const std::vector<size_t> &prev, size_t to, size_t w)
+    {
+      std::vector<Vec> res;
+      for (size_t idx = to; idx != invalid_idx; idx = prev[idx])
+        res.push_back(Vec{int(idx % w), int(idx / w)});
+      std::reverse(res.begin(), res.end());
+      return res;
+    }
+
+    // A* inside [lim_min, lim_max), weight > 1 turns it into weighted A*
+    template<typename Vec, typename OnExpand = NoExpandCallback>
+    static std::vector<Vec> find_path(const char *tiles, size_t w, size_t h, Vec from, Vec to,
+                                      Vec lim_min, Vec lim_max, float weight = 1.f,
+                                      OnExpand on_expand = OnExpand{})
+    {
+      if (from.x < 0 || from.y < 0 || from.x >= int(w) || from.y >= int(h))
+        return std::vector<Vec>();
+      const size_t inpSize = w * h;
+      const size_t toIdx = size_t(to.y) * w + size_t(to.x);
+
+      std::vector<float> g(inpSize, std::numeric_limits<float>::max());
+      std::vector<size_t> prev(inpSize, invalid_idx);
+      std::vector<bool> closed(inpSize, false);
+
+      using OpenEntry = std::pair<float, size_t>;
+      std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry>> openList;
+
+      const size_t fromIdx = size_t(from.y) * w + size_t(from.x);
+      g[fromIdx] = 0.f;
+      openList.push({weight * Heuristic::estimate(to.x - from.x, to.y - from.y), fromIdx});
+
+      while (!openList.empty())
+      {
+        const size_t idx = openList.top().second;
+        openList.pop();
+        if (idx == toIdx)
+          return reconstruct_path<Vec>(prev, toIdx, w);
+        if (closed[idx])
+          continue;
+        closed[idx] = true;
+        const int x = int(idx % w);
+        const int y = int(idx / w);
+        on_expand(x, y, g[idx]);
+        for_each_neighbour(tiles, w, x, y, lim_min.x, lim_min.y, lim_max.x, lim_max.y,
+          [&](size_t nidx, int nx, int ny, float len)
+          {
+            const float gScore = g[idx] + len * CostPolicy::cost(tiles[nidx]);
+            if (gScore < g[nidx])
+            {
+              prev[nidx] = idx;
+              g[nidx] = gScore;
+              openList.push({gScore + weight * Heuristic::estimate(to.x - nx, to.y - ny), nidx});
+            }
+          });
+      }
+      // empty path
+      return std::vector<Vec>();
+    }
+
+    template<typename Vec>
+    static std::vector<Vec> find_path(const char *tiles, size_t w, size_t h, Vec from, Vec to, float weight = 1.f)
+    {
+      return find_path(tiles, w, h, from, to, Vec{0, 0}, Vec{int(w), int(h)}, weight);
+    }
+
+    template<typename Vec>
+    static float ida_search(const char *tiles, size_t w, size_t h, std::vector<Vec> &path,
+                            const float g, const float bound, Vec to)
+    {
+      const Vec p = path.back();
+      const float f = g + Heuristic::estimate(to.x - p.x, to.y - p.y);
+      if (f > bound)
+        return f;
+      if (p.x == to.x && p.y == to.y)
+        return -f;
+      float min = std::numeric_limits<float>::max();
+      float found = 0.f;
+      for_each_neighbour(tiles, w, p.x, p.y, 0, 0, int(w), int(h),
+        [&](size_t nidx, int nx, int ny, float len)
+        {
+          if (found < 0.f)
+            return;
+          const Vec np{nx, ny};
+          if (std::find_if(path.begin(), path.end(),
+                [&](const Vec &v) { return v.x == nx && v.y == ny; }) != path.end())
+            return;
+          path.push_back(np);
+          const float t = ida_search(tiles, w, h, path, g + len * CostPolicy::cost(tiles[nidx]), bound, to);
+          if (t < 0.f)
+          {
+            found = t;
+            return;
+          }
+          min = std::min(min, t);
+          path.pop_back();
+        });
+      return found < 0.f ? found : min;
+    }
+
+    template<typename Vec>
+    static std::vector<Vec> find_path_ida(const char *tiles, size_t w, size_t h, Vec from, Vec to)
+    {
+      std::vector<Vec> path = {from};
+      if (from.x == to.x && from.y == to.y)
+        return path;
+      float bound = Heuristic::estimate(to.x - from.x, to.y - from.y);
+      while (true)
+      {
+        const float t = ida_search(tiles, w, h, path, 0.f, bound, to);
+        if (t < 0.f)
+          return path;
+        if (t == std::numeric_limits<float>::max())
+          return {};
+        bound = t;
+      }
+      return {};
+    }
+
+    // relaxes a dijkstra map in place until nothing changes, seeds are the initial values
+    static void scan_dmap(float *map, const char *tiles, size_t w, size_t h)
+    {
+      bool done = false;
+      while (!done)
+      {
+        done = true;
+        for (size_t y = 0; y < h; ++y)
+          for (size_t x = 0; x < w; ++x)
+          {
+            const size_t i = y * w + x;
+            if (!CostPolicy::passable(tiles[i]))
+              continue;
+            const float cost = CostPolicy::cost(tiles[i]);
+            float minVal = map[i];
+            for_each_neighbour(tiles, w, int(x), int(y), 0, 0, int(w), int(h),
+              [&](size_t nidx, int, int, float len)
+              {
+                minVal = std::min(minVal, map[nidx] + len * cost);
+              });
+            if (minVal < map[i])
+            {
+              map[i] = minVal;
+              done = false;
+            }
+          }
+      }
+    }
+  };
+};
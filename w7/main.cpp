@@ -1,6 +1,10 @@
 #include "raylib.h"
 #include <flecs.h>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
 #include <algorithm>
+#include <random>
 
 #include "ecsTypes.h"
 #include "shootEmUp.h"
@@ -22,8 +26,12 @@ static void update_camera(flecs::world &ecs)
 }
 
 
-int main(int /*argc*/, const char ** /*argv*/)
+int main(int argc, const char **argv)
 {
+  // pass a seed to replay the same dungeon and the same random decisions
+  const uint64_t seed = argc > 1 ? strtoull(argv[1], nullptr, 10) : std::random_device{}();
+  printf("seed %" PRIu64 "\n", seed);
+  rng::Rng rng(seed);
   int width = 1920;
   int height = 1080;
   InitWindow(width, height, "w6 AI MIPT");
@@ -39,13 +47,26 @@ int main(int /*argc*/, const char ** /*argv*/)
 
   flecs::world ecs;
   {
-    constexpr size_t dungWidth = 50;
-    constexpr size_t dungHeight = 50;
-    char *tiles = new char[dungWidth * dungHeight];
-    gen_drunk_dungeon(tiles, dungWidth, dungHeight);
-    init_dungeon(ecs, tiles, dungWidth, dungHeight);
+    // a map file after the seed is loaded when it's there, a new dungeon is saved to it otherwise,
+    // the dungeon has a stream of its own, so the game goes the same way either way
+    rng::Rng dungeonRng = rng.split();
+    mapfile::Dungeon map;
+    if (argc <= 2 || !mapfile::load(argv[2], map))
+    {
+      constexpr size_t dungWidth = 50;
+      constexpr size_t dungHeight = 50;
+      std::vector<char> tiles(dungWidth * dungHeight);
+      gen_drunk_dungeon(tiles.data(), dungWidth, dungHeight, dungeonRng);
+      map.info = mapfile::Info{dungWidth, dungHeight, seed, "drunk"};
+      if (argc > 2)
+        mapfile::save(argv[2], map.info, tiles.data(), nullptr, mapfile::Encoding::raw);
+      map.tiles = TileBuffer(std::move(tiles));
+    }
+    else if (map.info.seed != seed)
+      printf("%s was made with seed %" PRIu64 "\n", argv[2], map.info.seed);
+    init_dungeon(ecs, map);
   }
-  init_shoot_em_up(ecs);
+  init_shoot_em_up(ecs, rng);
 
   Camera2D camera = { {0, 0}, {0, 0}, 0.f, 1.f };
   camera.target = Vector2{ 0.f, 0.f };
@@ -1,100 +1,15 @@
 #include "pathfinder.h"
 #include "dungeonUtils.h"
 #include "math.h"
+#include "gridSearch.h"
 #include <algorithm>
 
-float heuristic(IVec2 lhs, IVec2 rhs)
-{
-  return sqrtf(sqr(float(lhs.x - rhs.x)) + sqr(float(lhs.y - rhs.y)));
-};
-
-template<typename T>
-static size_t coord_to_idx(T x, T y, size_t w)
-{
-  return size_t(y) * w + size_t(x);
-}
-
-static std::vector<IVec2> reconstruct_path(std::vector<IVec2> prev, IVec2 to, size_t width)
-{
-  IVec2 curPos = to;
-  std::vector<IVec2> res = {curPos};
-  while (prev[coord_to_idx(curPos.x, curPos.y, width)] != IVec2{-1, -1})
-  {
-    curPos = prev[coord_to_idx(curPos.x, curPos.y, width)];
-    res.insert(res.begin(), curPos);
-  }
-  return res;
-}
+using PortalSearch = grid::GridSearch<grid::Neighbourhood4, grid::UniformCost<dungeon::wall>, grid::Manhattan>;
 
 static std::vector<IVec2> find_path_a_star(const DungeonData &dd, IVec2 from, IVec2 to,
                                            IVec2 lim_min, IVec2 lim_max)
 {
-  if (from.x < 0 || from.y < 0 || from.x >= int(dd.width) || from.y >= int(dd.height))
-    return std::vector<IVec2>();
-  size_t inpSize = dd.width * dd.height;
-
-  std::vector<float> g(inpSize, std::numeric_limits<float>::max());
-  std::vector<float> f(inpSize, std::numeric_limits<float>::max());
-  std::vector<IVec2> prev(inpSize, {-1,-1});
-
-  auto getG = [&](IVec2 p) -> float { return g[coord_to_idx(p.x, p.y, dd.width)]; };
-  auto getF = [&](IVec2 p) -> float { return f[coord_to_idx(p.x, p.y, dd.width)]; };
-
-  g[coord_to_idx(from.x, from.y, dd.width)] = 0;
-  f[coord_to_idx(from.x, from.y, dd.width)] = heuristic(from, to);
-
-  std::vector<IVec2> openList = {from};
-  std::vector<IVec2> closedList;
-
-  while (!openList.empty())
-  {
-    size_t bestIdx = 0;
-    float bestScore = getF(openList[0]);
-    for (size_t i = 1; i < openList.size(); ++i)
-    {
-      float score = getF(openList[i]);
-      if (score < bestScore)
-      {
-        bestIdx = i;
-        bestScore = score;
-      }
-    }
-    if (openList[bestIdx] == to)
-      return reconstruct_path(prev, to, dd.width);
-    IVec2 curPos = openList[bestIdx];
-    openList.erase(openList.begin() + bestIdx);
-    if (std::find(closedList.begin(), closedList.end(), curPos) != closedList.end())
-      continue;
-    size_t idx = coord_to_idx(curPos.x, curPos.y, dd.width);
-    closedList.emplace_back(curPos);
-    auto checkNeighbour = [&](IVec2 p)
-    {
-      // out of bounds
-      if (p.x < lim_min.x || p.y < lim_min.y || p.x >= lim_max.x || p.y >= lim_max.y)
-        return;
-      size_t idx = coord_to_idx(p.x, p.y, dd.width);
-      // not empty
-      if (dd.tiles[idx] == dungeon::wall)
-        return;
-      float edgeWeight = 1.f;
-      float gScore = getG(curPos) + 1.f * edgeWeight; // we're exactly 1 unit away
-      if (gScore < getG(p))
-      {
-        prev[idx] = curPos;
-        g[idx] = gScore;
-        f[idx] = gScore + heuristic(p, to);
-      }
-      bool found = std::find(openList.begin(), openList.end(), p) != openList.end();
-      if (!found)
-        openList.emplace_back(p);
-    };
-    checkNeighbour({curPos.x + 1, curPos.y + 0});
-    checkNeighbour({curPos.x - 1, curPos.y + 0});
-    checkNeighbour({curPos.x + 0, curPos.y + 1});
-    checkNeighbour({curPos.x + 0, curPos.y - 1});
-  }
-  // empty path
-  return std::vector<IVec2>();
+  return PortalSearch::find_path(dd.tiles.data(), dd.width, dd.height, from, to, lim_min, lim_max);
 }
 
 
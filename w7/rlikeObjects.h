@@ -2,6 +2,7 @@
 #include <flecs.h>
 #include "raylib.h"
 #include "ecsTypes.h"
+#include "rng.h"
 
 flecs::entity create_monster(flecs::world &ecs, Position pos, Color col, const char *texture_src);
 void create_player(flecs::world &ecs, Position pos, const char *texture_src);
@@ -10,5 +11,6 @@ struct MonsterSpawner
 {
   float timeToSpawn;
   float timeBetweenSpawns;
+  rng::Rng rng; // spawns are reproducible when it's split off the game's generator
 };
 
@@ -5,6 +5,7 @@
 #include "steering.h"
 #include "dungeonGen.h"
 #include "dungeonUtils.h"
+#include "tileMap.h"
 #include "pathfinder.h"
 
 constexpr float tile_size = 64.f;
@@ -29,19 +30,16 @@ static void register_roguelike_systems(flecs::world &ecs)
     {
       pos += vel * ecs.delta_time();
     });
-  ecs.system<const Position, const Color>()
-    .term<TextureSource>(flecs::Wildcard)
-    .term<BackgroundTile>()
-    .each([&](flecs::entity e, const Position &pos, const Color color)
+  static auto cameraQuery = ecs.query<const Camera2D>();
+  ecs.system<const TileMap, const Texture2D>()
+    .each([&](const TileMap &map, const Texture2D &atlas)
     {
-      const auto textureSrc = e.target<TextureSource>();
-      DrawTextureQuad(*textureSrc.get<Texture2D>(),
-          Vector2{1, 1}, Vector2{0, 0},
-          Rectangle{float(pos.x), float(pos.y), tile_size, tile_size}, color);
+      const Camera2D *camera = nullptr;
+      cameraQuery.each([&](const Camera2D &cam) { camera = &cam; });
+      tilemap::draw(map, atlas, tile_size, camera);
     });
   ecs.system<const Position, const Color>()
     .term<TextureSource>(flecs::Wildcard)
-    .term<BackgroundTile>().not_()
     .each([&](flecs::entity e, const Position &pos, const Color color)
     {
       const auto textureSrc = e.target<TextureSource>();
@@ -64,12 +62,12 @@ static void register_roguelike_systems(flecs::world &ecs)
         ms.timeToSpawn -= ecs.delta_time();
         while (ms.timeToSpawn < 0.f)
         {
-          steer::Type st = steer::Type(GetRandomValue(0, steer::Type::Num - 1));
+          steer::Type st = steer::Type(ms.rng.range(0, steer::Type::Num - 1));
           const Color colors[steer::Type::Num] = {WHITE, RED, BLUE, GREEN};
           const float distances[steer::Type::Num] = {800.f, 800.f, 300.f, 300.f};
           const float dist = distances[st];
           constexpr int angRandMax = 1 << 16;
-          const float angle = float(GetRandomValue(0, angRandMax)) / float(angRandMax) * PI * 2.f;
+          const float angle = float(ms.rng.range(0, angRandMax)) / float(angRandMax) * PI * 2.f;
           Color col = colors[st];
           steer::create_steer_beh(create_monster(ecs,
               {pp.x + cosf(angle) * dist, pp.y + sinf(angle) * dist}, col, "minotaur_tex"), st);
@@ -78,7 +76,6 @@ static void register_roguelike_systems(flecs::world &ecs)
       });
     });
 
-  static auto cameraQuery = ecs.query<const Camera2D>();
   ecs.system<const DungeonPortals, const DungeonData>()
     .each([&](const DungeonPortals &dp, const DungeonData &dd)
     {
@@ -141,7 +138,7 @@ static void register_roguelike_systems(flecs::world &ecs)
 }
 
 
-void init_shoot_em_up(flecs::world &ecs)
+void init_shoot_em_up(flecs::world &ecs, rng::Rng &rng)
 {
   register_roguelike_systems(ecs);
 
@@ -150,38 +147,28 @@ void init_shoot_em_up(flecs::world &ecs)
   ecs.entity("minotaur_tex")
     .set(Texture2D{LoadTexture("assets/minotaur.png")});
 
-  const Position walkableTile = dungeon::find_walkable_tile(ecs);
+  const Position walkableTile = dungeon::find_walkable_tile(ecs, rng);
   create_player(ecs, walkableTile * tile_size, "swordsman_tex");
 }
 
-void init_dungeon(flecs::world &ecs, char *tiles, size_t w, size_t h)
+void init_dungeon(flecs::world &ecs, const mapfile::Dungeon &map)
 {
-  flecs::entity wallTex = ecs.entity("wall_tex")
-    .set(Texture2D{LoadTexture("assets/wall.png")});
-  flecs::entity floorTex = ecs.entity("floor_tex")
-    .set(Texture2D{LoadTexture("assets/floor.png")});
-
-  std::vector<char> dungeonData;
-  dungeonData.resize(w * h);
-  for (size_t y = 0; y < h; ++y)
-    for (size_t x = 0; x < w; ++x)
-      dungeonData[y * w + x] = tiles[y * w + x];
+  const size_t w = map.info.width;
+  const size_t h = map.info.height;
+  // tiles are shared with the map, no copy when they're in a mapped file
+  const DungeonData dd{map.tiles, w, h};
+  WalkableIndex walkable;
+  dungeon::init_walkable_index(dd, walkable);
+  // background is a single component, cell 0 of the atlas is floor, 1 is wall
+  TileMap tileMap{w, h, 0, std::vector<uint8_t>(w * h, 0)};
+  const Texture2D atlas = tilemap::load_atlas({{"assets/floor.png"}, {"assets/wall.png"}}, tileMap.cellSize);
+  for (size_t i = 0; i < w * h; ++i)
+    tileMap.ids[i] = map.tiles[i] == dungeon::wall ? 1 : 0;
   ecs.entity("dungeon")
-    .set(DungeonData{dungeonData, w, h});
-
-  for (size_t y = 0; y < h; ++y)
-    for (size_t x = 0; x < w; ++x)
-    {
-      char tile = tiles[y * w + x];
-      flecs::entity tileEntity = ecs.entity()
-        .add<BackgroundTile>()
-        .set(Position{float(x) * tile_size, float(y) * tile_size})
-        .set(Color{255, 255, 255, 255});
-      if (tile == dungeon::wall)
-        tileEntity.add<TextureSource>(wallTex);
-      else if (tile == dungeon::floor)
-        tileEntity.add<TextureSource>(floorTex);
-    }
+    .set(dd)
+    .set(walkable)
+    .set(std::move(tileMap))
+    .set(Texture2D{atlas});
   prebuild_map(ecs);
 }
 
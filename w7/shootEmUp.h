@@ -1,7 +1,9 @@
 #pragma once
 #include <flecs.h>
+#include "dungeonFile.h"
+#include "rng.h"
 
-void init_shoot_em_up(flecs::world &ecs);
+void init_shoot_em_up(flecs::world &ecs, rng::Rng &rng);
 void process_game(flecs::world &ecs);
-void init_dungeon(flecs::world &ecs, char *tiles, size_t w, size_t h);
+void init_dungeon(flecs::world &ecs, const mapfile::Dungeon &map);
 
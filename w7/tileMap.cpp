@@ -0,0 +1,73 @@
+#include "tileMap.h"
+#include <algorithm>
+#include <cmath>
+
+Texture2D tilemap::load_atlas(const std::vector<AtlasCell> &cells, int &cell_size)
+{
+  std::vector<Image> images;
+  cell_size = 1;
+  for (const AtlasCell &cell : cells)
+  {
+    images.push_back(cell.path ? LoadImage(cell.path) : Image{});
+    if (images.back().data)
+      cell_size = std::max(cell_size, images.back().height);
+  }
+  Image atlas = GenImageColor(cell_size * int(cells.size()), cell_size, BLANK);
+  for (size_t i = 0; i < cells.size(); ++i)
+  {
+    const Rectangle dst{float(i) * float(cell_size), 0.f, float(cell_size), float(cell_size)};
+    if (!images[i].data)
+    {
+      ImageDrawRectangleRec(&atlas, dst, cells[i].color);
+      continue;
+    }
+    ImageDraw(&atlas, images[i], Rectangle{0.f, 0.f, float(images[i].width), float(images[i].height)}, dst,
+              cells[i].color);
+    UnloadImage(images[i]);
+  }
+  Texture2D res = LoadTextureFromImage(atlas);
+  UnloadImage(atlas);
+  // neighbouring cells would bleed in with filtering
+  SetTextureFilter(res, TEXTURE_FILTER_POINT);
+  return res;
+}
+
+void tilemap::draw(const TileMap &map, const Texture2D &atlas, float tile_size, const Camera2D *camera)
+{
+  size_t minX = 0;
+  size_t minY = 0;
+  size_t maxX = map.width;
+  size_t maxY = map.height;
+  if (camera)
+  {
+    const float screenW = float(GetScreenWidth());
+    const float screenH = float(GetScreenHeight());
+    const Vector2 corners[4] = {GetScreenToWorld2D(Vector2{0.f, 0.f}, *camera),
+                                GetScreenToWorld2D(Vector2{screenW, 0.f}, *camera),
+                                GetScreenToWorld2D(Vector2{0.f, screenH}, *camera),
+                                GetScreenToWorld2D(Vector2{screenW, screenH}, *camera)};
+    float left = corners[0].x;
+    float right = corners[0].x;
+    float top = corners[0].y;
+    float bottom = corners[0].y;
+    for (const Vector2 &corner : corners)
+    {
+      left = std::min(left, corner.x);
+      right = std::max(right, corner.x);
+      top = std::min(top, corner.y);
+      bottom = std::max(bottom, corner.y);
+    }
+    // tiles partly on screen count too
+    auto clamp_tile = [](float v, size_t size) { return size_t(std::clamp(v, 0.f, float(size))); };
+    minX = clamp_tile(std::floor(left / tile_size), map.width);
+    minY = clamp_tile(std::floor(top / tile_size), map.height);
+    maxX = clamp_tile(std::ceil(right / tile_size), map.width);
+    maxY = clamp_tile(std::ceil(bottom / tile_size), map.height);
+  }
+  const float cell = float(map.cellSize);
+  for (size_t y = minY; y < maxY; ++y)
+    for (size_t x = minX; x < maxX; ++x)
+      DrawTexturePro(atlas, Rectangle{float(map.ids[y * map.width + x]) * cell, 0.f, cell, cell},
+                     Rectangle{float(x) * tile_size, float(y) * tile_size, tile_size, tile_size},
+                     Vector2{0.f, 0.f}, 0.f, WHITE);
+}
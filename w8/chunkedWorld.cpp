@@ -0,0 +1,216 @@
+#include "chunkedWorld.h"
+#include "dungeonUtils.h"
+#include <cstring> // memset, memcpy
+#include <algorithm>
+#include "rng.h"
+
+using world::ChunkCoord;
+using world::chunk_size;
+
+// every chunk has its own generator, stream 0 is for the anchor and walkers, 1 for noise
+static rng::Rng chunk_stream(const world::WorldParams &params, ChunkCoord coord, int stream)
+{
+  rng::Rng res(params.seed, (uint64_t(uint32_t(coord.x)) << 32) | uint32_t(coord.y));
+  for (int i = 0; i < stream; ++i)
+    res.split();
+  return res;
+}
+
+static void gen_cellular_chunk(const world::WorldParams &params, ChunkCoord coord, char *tiles,
+                               CellularBuffers &buffers)
+{
+  // the rule looks 2 tiles away, that is how far changes travel in an iteration
+  const size_t iter = std::min(params.cellularIter, size_t(chunk_size / 2));
+  const int apron = int(2 * iter);
+  const int side = chunk_size + 2 * apron;
+  std::vector<char> padded(size_t(side * side));
+  for (int ny = -1; ny <= 1; ++ny)
+    for (int nx = -1; nx <= 1; ++nx)
+    {
+      // noise of a chunk is always drawn whole, so it's the same for every chunk reading it
+      rng::Rng rng = chunk_stream(params, ChunkCoord{coord.x + nx, coord.y + ny}, 1);
+      for (int y = 0; y < chunk_size; ++y)
+        for (int x = 0; x < chunk_size; ++x)
+        {
+          const char tile = rng.uniform() < params.fillrate ? dungeon::wall : dungeon::floor;
+          const int px = nx * chunk_size + x + apron;
+          const int py = ny * chunk_size + y + apron;
+          if (px >= 0 && py >= 0 && px < side && py < side)
+            padded[size_t(py * side + px)] = tile;
+        }
+    }
+  // outer tiles of the apron go wrong near the walls around it, but not far enough to reach the chunk
+  run_cellular(padded.data(), size_t(side), size_t(side), iter, buffers);
+  for (int y = 0; y < chunk_size; ++y)
+    memcpy(tiles + y * chunk_size, padded.data() + (y + apron) * side + apron, chunk_size);
+}
+
+static IVec2 anchor_of(rng::Rng &rng, ChunkCoord coord)
+{
+  return IVec2{coord.x * chunk_size + rng.range(0, chunk_size - 1), coord.y * chunk_size + rng.range(0, chunk_size - 1)};
+}
+
+static IVec2 anchor_of(const world::WorldParams &params, ChunkCoord coord)
+{
+  rng::Rng rng = chunk_stream(params, coord, 0);
+  return anchor_of(rng, coord);
+}
+
+// calls carve(pos) for every tile walkers of the chunk step on, in world coords
+template<typename Callable>
+static void walk_chunk(const world::WorldParams &params, ChunkCoord coord, Callable carve)
+{
+  const int dirs[4][2] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1}};
+  rng::Rng rng = chunk_stream(params, coord, 0);
+  const IVec2 anchor = anchor_of(rng, coord);
+  // walkers are kept inside the 3x3 chunks around their own one
+  const int minX = (coord.x - 1) * chunk_size;
+  const int minY = (coord.y - 1) * chunk_size;
+  const int maxX = (coord.x + 2) * chunk_size - 1;
+  const int maxY = (coord.y + 2) * chunk_size - 1;
+  for (size_t walker = 0; walker < params.walkers; ++walker)
+  {
+    IVec2 pos = anchor;
+    carve(pos);
+    for (size_t step = 0; step < params.walkSteps; ++step)
+    {
+      const int *dir = dirs[rng.range(0, 3)];
+      pos.x = std::clamp(pos.x + dir[0], minX, maxX);
+      pos.y = std::clamp(pos.y + dir[1], minY, maxY);
+      carve(pos);
+    }
+  }
+}
+
+static void gen_drunk_chunk(const world::WorldParams &params, ChunkCoord coord, char *tiles)
+{
+  memset(tiles, dungeon::wall, chunk_size * chunk_size);
+  const IVec2 origin{coord.x * chunk_size, coord.y * chunk_size};
+  auto carve = [&](IVec2 pos)
+  {
+    const int x = pos.x - origin.x;
+    const int y = pos.y - origin.y;
+    if (x >= 0 && y >= 0 && x < chunk_size && y < chunk_size)
+      tiles[y * chunk_size + x] = dungeon::floor;
+  };
+  for (int ny = -1; ny <= 1; ++ny)
+    for (int nx = -1; nx <= 1; ++nx)
+      walk_chunk(params, ChunkCoord{coord.x + nx, coord.y + ny}, carve);
+  // corridors only run between the anchors of a chunk and its right and bottom neighbours,
+  // these four are all that can cross this chunk
+  const ChunkCoord links[4][2] = {{coord, {coord.x + 1, coord.y}}, {coord, {coord.x, coord.y + 1}},
+                                  {{coord.x - 1, coord.y}, coord}, {{coord.x, coord.y - 1}, coord}};
+  for (const auto &link : links)
+    for_each_on_line(anchor_of(params, link[0]), anchor_of(params, link[1]), carve);
+}
+
+void world::gen_chunk(const WorldParams &params, ChunkCoord coord, char *tiles, CellularBuffers &buffers)
+{
+  if (params.gen == ChunkGen::cellular)
+    gen_cellular_chunk(params, coord, tiles, buffers);
+  else
+    gen_drunk_chunk(params, coord, tiles);
+}
+
+world::ChunkedWorld::ChunkedWorld(const WorldParams &world_params, int keep_radius)
+  : params(world_params), keepRadius(keep_radius)
+{
+}
+
+uint64_t world::ChunkedWorld::key_of(ChunkCoord coord)
+{
+  return (uint64_t(uint32_t(coord.x)) << 32) | uint32_t(coord.y);
+}
+
+world::ChunkedWorld::Chunk &world::ChunkedWorld::load(ChunkCoord coord)
+{
+  const uint64_t key = key_of(coord);
+  Chunk &chunk = resident[key];
+  if (!chunk.tiles.empty())
+    return chunk;
+  chunk.tiles.resize(chunk_size * chunk_size);
+  auto stored = store.find(key);
+  if (stored == store.end())
+  {
+    gen_chunk(params, coord, chunk.tiles.data(), buffers);
+    return chunk;
+  }
+  for (size_t i = 0; i < chunk.tiles.size(); ++i)
+    chunk.tiles[i] = (stored->second[i / 64] >> (i % 64)) & 1 ? dungeon::wall : dungeon::floor;
+  chunk.dirty = true;
+  store.erase(stored);
+  return chunk;
+}
+
+void world::ChunkedWorld::evict(uint64_t key, Chunk &chunk)
+{
+  if (!chunk.dirty)
+    return;
+  std::vector<uint64_t> &bits = store[key];
+  bits.assign((chunk.tiles.size() + 63) / 64, 0);
+  for (size_t i = 0; i < chunk.tiles.size(); ++i)
+    if (chunk.tiles[i] == dungeon::wall)
+      bits[i / 64] |= uint64_t(1) << (i % 64);
+}
+
+void world::ChunkedWorld::update(const std::vector<IVec2> &active)
+{
+  std::vector<uint64_t> keep;
+  for (const IVec2 &pos : active)
+  {
+    const ChunkCoord center = chunk_of(pos.x, pos.y);
+    for (int y = center.y - keepRadius; y <= center.y + keepRadius; ++y)
+      for (int x = center.x - keepRadius; x <= center.x + keepRadius; ++x)
+        keep.push_back(key_of(ChunkCoord{x, y}));
+  }
+  std::sort(keep.begin(), keep.end());
+  for (auto it = resident.begin(); it != resident.end();)
+  {
+    if (std::binary_search(keep.begin(), keep.end(), it->first))
+    {
+      ++it;
+      continue;
+    }
+    evict(it->first, it->second);
+    it = resident.erase(it);
+  }
+  for (const IVec2 &pos : active)
+  {
+    const ChunkCoord center = chunk_of(pos.x, pos.y);
+    for (int y = center.y - keepRadius; y <= center.y + keepRadius; ++y)
+      for (int x = center.x - keepRadius; x <= center.x + keepRadius; ++x)
+        load(ChunkCoord{x, y});
+  }
+}
+
+char world::ChunkedWorld::get(int x, int y)
+{
+  const ChunkCoord coord = chunk_of(x, y);
+  return load(coord).tiles[size_t((y - coord.y * chunk_size) * chunk_size + x - coord.x * chunk_size)];
+}
+
+void world::ChunkedWorld::set(int x, int y, char tile)
+{
+  const ChunkCoord coord = chunk_of(x, y);
+  Chunk &chunk = load(coord);
+  chunk.tiles[size_t((y - coord.y * chunk_size) * chunk_size + x - coord.x * chunk_size)] = tile;
+  chunk.dirty = true;
+}
+
+void world::ChunkedWorld::copy_region(int x, int y, size_t w, size_t h, char *out)
+{
+  for (size_t row = 0; row < h; ++row)
+    for (size_t col = 0; col < w;)
+    {
+      // whole runs inside one chunk at a time
+      const int tx = x + int(col);
+      const int ty = y + int(row);
+      const ChunkCoord coord = chunk_of(tx, ty);
+      const Chunk &chunk = load(coord);
+      const int lx = tx - coord.x * chunk_size;
+      const int ly = ty - coord.y * chunk_size;
+      const size_t run = std::min(w - col, size_t(chunk_size - lx));
+      memcpy(out + row * w + col, chunk.tiles.data() + ly * chunk_size + lx, run);
+      col += run;
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef> // size_t
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "dungeonGen.h"
+#include "math.h"
+
+namespace world
+{
+  constexpr int chunk_size = 64;
+
+  struct ChunkCoord
+  {
+    int x, y;
+  };
+
+  inline ChunkCoord chunk_of(int x, int y)
+  {
+    // floor division, chunks to the left and above the origin have negative coords
+    return ChunkCoord{x >= 0 ? x / chunk_size : (x + 1) / chunk_size - 1,
+                      y >= 0 ? y / chunk_size : (y + 1) / chunk_size - 1};
+  }
+
+  enum class ChunkGen
+  {
+    cellular,
+    drunk,
+  };
+
+  struct WorldParams
+  {
+    uint64_t seed = 0;
+    ChunkGen gen = ChunkGen::cellular;
+    float fillrate = 0.45f;
+    size_t cellularIter = 10; // at most chunk_size / 2
+    size_t walkers = 4; // per chunk
+    size_t walkSteps = 600;
+  };
+
+  // Tiles of one chunk of an unbounded world, the same for the same seed and coords no matter
+  // which chunks were made before. Cellular caves run on the chunk with an apron of
+  // 2 * cellularIter tiles of the neighbours' noise, changes travel two tiles per iteration,
+  // so tiles match on both sides of a seam. Drunk walkers start at an anchor of their chunk and
+  // stay inside the 3x3 chunks around it, a chunk replays the walkers of its neighbours and
+  // keeps what falls inside. Anchors are joined to the right and bottom neighbours' ones.
+  void gen_chunk(const WorldParams &params, ChunkCoord coord, char *tiles, CellularBuffers &buffers);
+
+  // Chunks are made on demand around active positions and dropped when nothing is around.
+  // Untouched chunks are simply made again later, chunks changed with set() go to a store
+  // with one bit per tile, so tiles should be walls or floor. Memory only grows with edits.
+  class ChunkedWorld
+  {
+  public:
+    explicit ChunkedWorld(const WorldParams &params, int keep_radius = 2);
+
+    // chunks within keep_radius of any of the positions stay resident, the rest are evicted
+    void update(const std::vector<IVec2> &active);
+
+    char get(int x, int y);
+    void set(int x, int y, char tile);
+    // w x h tiles starting at x, y into out, row-major
+    void copy_region(int x, int y, size_t w, size_t h, char *out);
+
+    size_t resident_count() const { return resident.size(); }
+    size_t stored_count() const { return store.size(); }
+
+  private:
+    struct Chunk
+    {
+      std::vector<char> tiles;
+      bool dirty = false;
+    };
+
+    static uint64_t key_of(ChunkCoord coord);
+    Chunk &load(ChunkCoord coord);
+    void evict(uint64_t key, Chunk &chunk);
+
+    WorldParams params;
+    int keepRadius;
+    std::unordered_map<uint64_t, Chunk> resident;
+    std::unordered_map<uint64_t, std::vector<uint64_t>> store;
+    CellularBuffers buffers;
+  };
+};
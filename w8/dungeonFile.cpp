@@ -0,0 +1,243 @@
+#include "dungeonFile.h"
+#include <cstdio>
+#include <cstring> // memcpy, strnlen
+#include <algorithm>
+#include <memory>
+#include <vector>
+#if defined(_WIN32)
+// no mmap there, files are read into memory instead
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+  struct Layer
+  {
+    uint64_t offset; // from the start of the file
+    uint64_t bytes; // 0 if there is no layer
+    uint32_t encoding;
+    char values[2]; // tiles a 0 and a 1 bit stand for in bits layers
+    char pad[2];
+  };
+
+  // written as it is in memory, all targets are little endian
+  struct Header
+  {
+    char magic[4];
+    uint32_t version;
+    uint64_t width;
+    uint64_t height;
+    uint64_t seed;
+    Layer tiles;
+    Layer explore;
+    char generator[64];
+  };
+
+  // the whole file, mapped where there's mmap
+  struct FileData
+  {
+    const char *data = nullptr;
+    size_t size = 0;
+#if defined(_WIN32)
+    std::vector<char> bytes;
+#else
+    void *mapping = nullptr;
+
+    ~FileData()
+    {
+      if (mapping)
+        munmap(mapping, size);
+    }
+#endif
+  };
+}
+
+// sizes in the header are used as they are
+static_assert(sizeof(size_t) == sizeof(uint64_t), "dungeon files need a 64-bit size_t");
+
+static constexpr char file_magic[4] = {'D', 'N', 'G', 'F'};
+// layers start at a multiple of a cache line
+static constexpr uint64_t layer_align = 64;
+
+static bool encode_layer(const char *tiles, size_t count, mapfile::Encoding encoding, Layer &layer,
+                         std::vector<char> &res)
+{
+  layer = Layer{};
+  layer.encoding = uint32_t(encoding);
+  if (encoding == mapfile::Encoding::raw)
+  {
+    res.assign(tiles, tiles + count);
+    layer.bytes = res.size();
+    return true;
+  }
+  std::vector<uint64_t> bits((count + 63) / 64, 0);
+  layer.values[0] = layer.values[1] = count ? tiles[0] : 0;
+  bool hasSecond = false;
+  for (size_t i = 0; i < count; ++i)
+  {
+    if (tiles[i] == layer.values[0])
+      continue;
+    if (!hasSecond)
+    {
+      layer.values[1] = tiles[i];
+      hasSecond = true;
+    }
+    else if (tiles[i] != layer.values[1])
+      return false;
+    bits[i / 64] |= uint64_t(1) << (i % 64);
+  }
+  res.resize(bits.size() * sizeof(uint64_t));
+  memcpy(res.data(), bits.data(), res.size());
+  layer.bytes = res.size();
+  return true;
+}
+
+bool mapfile::save(const char *path, const Info &info, const char *tiles, const char *explore, Encoding encoding)
+{
+  const size_t count = info.width * info.height;
+  Header header{};
+  memcpy(header.magic, file_magic, sizeof(file_magic));
+  header.version = version;
+  header.width = info.width;
+  header.height = info.height;
+  header.seed = info.seed;
+  memcpy(header.generator, info.generator.c_str(), std::min(info.generator.size(), sizeof(header.generator) - 1));
+
+  std::vector<char> tilesData;
+  std::vector<char> exploreData;
+  if (!encode_layer(tiles, count, encoding, header.tiles, tilesData) ||
+      (explore && !encode_layer(explore, count, encoding, header.explore, exploreData)))
+  {
+    printf("dungeon file %s: a layer has more than two kinds of tiles, save it raw\n", path);
+    return false;
+  }
+  auto aligned = [](uint64_t offset) { return (offset + layer_align - 1) / layer_align * layer_align; };
+  header.tiles.offset = aligned(sizeof(Header));
+  header.explore.offset = explore ? aligned(header.tiles.offset + header.tiles.bytes) : 0;
+
+  FILE *file = fopen(path, "wb");
+  if (!file)
+  {
+    printf("can't write dungeon file %s\n", path);
+    return false;
+  }
+  std::vector<char> contents(explore ? header.explore.offset + header.explore.bytes
+                                     : header.tiles.offset + header.tiles.bytes, 0);
+  memcpy(contents.data(), &header, sizeof(header));
+  memcpy(contents.data() + header.tiles.offset, tilesData.data(), tilesData.size());
+  if (explore)
+    memcpy(contents.data() + header.explore.offset, exploreData.data(), exploreData.size());
+  const bool written = fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+  if (fclose(file) != 0 || !written)
+  {
+    printf("can't write dungeon file %s\n", path);
+    return false;
+  }
+  return true;
+}
+
+static std::shared_ptr<FileData> read_file(const char *path)
+{
+  auto res = std::make_shared<FileData>();
+#if defined(_WIN32)
+  FILE *file = fopen(path, "rb");
+  if (!file)
+    return nullptr;
+  fseek(file, 0, SEEK_END);
+  const long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  res->bytes.resize(size > 0 ? size_t(size) : 0);
+  const bool read = fread(res->bytes.data(), 1, res->bytes.size(), file) == res->bytes.size();
+  fclose(file);
+  if (!read || res->bytes.empty())
+    return nullptr;
+  res->data = res->bytes.data();
+  res->size = res->bytes.size();
+#else
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return nullptr;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0)
+  {
+    close(fd);
+    return nullptr;
+  }
+  // private read-only pages, nothing is read until tiles are touched
+  void *mapping = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED)
+    return nullptr;
+  res->mapping = mapping;
+  res->data = static_cast<const char *>(mapping);
+  res->size = size_t(st.st_size);
+#endif
+  return res;
+}
+
+static bool decode_layer(const std::shared_ptr<FileData> &file, const Layer &layer, size_t count, TileBuffer &res)
+{
+  if (layer.offset > file->size || layer.bytes > file->size - layer.offset)
+    return false;
+  const char *src = file->data + layer.offset;
+  if (layer.encoding == uint32_t(mapfile::Encoding::raw))
+  {
+    if (layer.bytes != count)
+      return false;
+    res = TileBuffer(file, src, count);
+    return true;
+  }
+  if (layer.encoding != uint32_t(mapfile::Encoding::bits) || layer.bytes != (count + 63) / 64 * sizeof(uint64_t))
+    return false;
+  std::vector<char> tiles(count);
+  for (size_t w = 0; w * 64 < count; ++w)
+  {
+    uint64_t word;
+    memcpy(&word, src + w * sizeof(uint64_t), sizeof(word));
+    for (size_t i = w * 64; i < std::min(count, w * 64 + 64); ++i)
+      tiles[i] = layer.values[(word >> (i % 64)) & 1];
+  }
+  res = TileBuffer(std::move(tiles));
+  return true;
+}
+
+bool mapfile::load(const char *path, Dungeon &res)
+{
+  const std::shared_ptr<FileData> file = read_file(path);
+  if (!file)
+  {
+    printf("can't read dungeon file %s\n", path);
+    return false;
+  }
+  Header header;
+  if (file->size < sizeof(header))
+  {
+    printf("dungeon file %s is too short\n", path);
+    return false;
+  }
+  memcpy(&header, file->data, sizeof(header));
+  if (memcmp(header.magic, file_magic, sizeof(file_magic)) != 0 || header.version != version)
+  {
+    printf("%s isn't a dungeon file of version %u\n", path, version);
+    return false;
+  }
+  const size_t count = header.width * header.height;
+  if (header.width == 0 || count / header.width != header.height ||
+      !decode_layer(file, header.tiles, count, res.tiles) ||
+      (header.explore.bytes && !decode_layer(file, header.explore, count, res.explore)))
+  {
+    printf("dungeon file %s is broken\n", path);
+    return false;
+  }
+  if (!header.explore.bytes)
+    res.explore = TileBuffer();
+  res.info.width = header.width;
+  res.info.height = header.height;
+  res.info.seed = header.seed;
+  res.info.generator.assign(header.generator, strnlen(header.generator, sizeof(header.generator)));
+  return true;
+}
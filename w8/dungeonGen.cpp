@@ -1,15 +1,165 @@
 #include "dungeonGen.h"
 #include "dungeonUtils.h"
+#include <cstdio>
 #include <cstring> // memset
-#include <raylib.h>
+#include <cstdint>
 #include <algorithm>
+#include <bit>
+#include <string>
 #include <vector>
-#include <random>
 #include "math.h"
-#include <limits>
+#include "jobGraph.h"
+#include "rng.h"
+
+static int64_t dist_sq_int(IVec2 a, IVec2 b)
+{
+  return sqr(int64_t(a.x - b.x)) + sqr(int64_t(a.y - b.y));
+}
+
+// points bucketed into square cells, points of cell c are points[cellStart[c]..cellStart[c + 1])
+struct PointGrid
+{
+  const std::vector<IVec2> *positions = nullptr;
+  int cell = 1;
+  int cols = 0;
+  int rows = 0;
+  std::vector<uint32_t> cellStart;
+  std::vector<uint32_t> points;
+
+  int cell_of(IVec2 p) const { return p.y / cell * cols + p.x / cell; }
+
+  void build(const std::vector<IVec2> &pos, size_t w, size_t h)
+  {
+    positions = &pos;
+    // a couple of points per cell on average
+    cell = std::max(int(std::sqrt(float(w * h) / float(pos.size()))), 1);
+    cols = int(w) / cell + 1;
+    rows = int(h) / cell + 1;
+    cellStart.assign(size_t(cols * rows) + 1, 0);
+    for (const IVec2 &p : pos)
+      ++cellStart[size_t(cell_of(p)) + 1];
+    for (size_t c = 1; c < cellStart.size(); ++c)
+      cellStart[c] += cellStart[c - 1];
+    points.resize(pos.size());
+    std::vector<uint32_t> fill(cellStart.begin(), cellStart.end() - 1);
+    for (size_t i = 0; i < pos.size(); ++i)
+      points[fill[size_t(cell_of(pos[i]))]++] = uint32_t(i);
+  }
+
+  // up to k points closest to p that pass accept(idx), closest first, searched in
+  // growing rings of cells until no point further out can be closer
+  template<typename Accept>
+  void closest(IVec2 p, size_t k, Accept accept, std::vector<std::pair<int64_t, uint32_t>> &res) const
+  {
+    res.clear();
+    const int cx = p.x / cell;
+    const int cy = p.y / cell;
+    for (int r = 0; r <= std::max(cols, rows); ++r)
+    {
+      for (int y = cy - r; y <= cy + r; ++y)
+      {
+        // rows inside the ring only have cells on its two sides
+        const int xStep = y == cy - r || y == cy + r ? 1 : 2 * r;
+        for (int x = cx - r; x <= cx + r; x += xStep)
+        {
+          if (x < 0 || y < 0 || x >= cols || y >= rows)
+            continue;
+          const size_t c = size_t(y * cols + x);
+          for (uint32_t i = cellStart[c]; i < cellStart[c + 1]; ++i)
+          {
+            const uint32_t idx = points[i];
+            if (!accept(idx))
+              continue;
+            const std::pair<int64_t, uint32_t> item{dist_sq_int(p, (*positions)[idx]), idx};
+            if (res.size() == k && item >= res.back())
+              continue;
+            if (res.size() == k)
+              res.pop_back();
+            res.insert(std::upper_bound(res.begin(), res.end(), item), item);
+          }
+        }
+      }
+      // everything outside of ring r is at least r cells away
+      const int64_t reach = int64_t(r) * cell;
+      if (res.size() == k && res.back().first <= reach * reach)
+        break;
+    }
+  }
+};
+
+static uint32_t find_set(std::vector<uint32_t> &parent, uint32_t i)
+{
+  while (parent[i] != i)
+  {
+    parent[i] = parent[parent[i]];
+    i = parent[i];
+  }
+  return i;
+}
+
+// corridors along the minimum spanning tree of the nearest neighbours graph of positions,
+// Kruskal over edges to the 8 closest points of each point found with a grid
+static void connect_points(char *tiles, size_t w, size_t h, const std::vector<IVec2> &positions)
+{
+  // points are tiles, without repeats there are never more of them in a cell than it has tiles
+  std::vector<IVec2> points = positions;
+  std::sort(points.begin(), points.end(), [](IVec2 a, IVec2 b) { return a.y != b.y ? a.y < b.y : a.x < b.x; });
+  points.erase(std::unique(points.begin(), points.end()), points.end());
+  if (points.size() < 2)
+    return;
+  constexpr size_t neighbours = 8;
+  PointGrid grid;
+  grid.build(points, w, h);
+  struct Edge
+  {
+    int64_t distSq;
+    uint32_t from;
+    uint32_t to;
+  };
+  std::vector<Edge> edges;
+  edges.reserve(points.size() * neighbours);
+  std::vector<std::pair<int64_t, uint32_t>> closest;
+  for (uint32_t i = 0; i < uint32_t(points.size()); ++i)
+  {
+    grid.closest(points[i], neighbours, [i](uint32_t j) { return j != i; }, closest);
+    for (const auto &[distSq, j] : closest)
+      edges.push_back(Edge{distSq, std::min(i, j), std::max(i, j)});
+  }
+  std::sort(edges.begin(), edges.end(), [](const Edge &a, const Edge &b)
+  {
+    return a.distSq != b.distSq ? a.distSq < b.distSq : a.from != b.from ? a.from < b.from : a.to < b.to;
+  });
+
+  std::vector<uint32_t> parent(points.size());
+  for (uint32_t i = 0; i < uint32_t(parent.size()); ++i)
+    parent[i] = i;
+  size_t parts = points.size();
+  auto join = [&](uint32_t a, uint32_t b)
+  {
+    const uint32_t ra = find_set(parent, a);
+    const uint32_t rb = find_set(parent, b);
+    if (ra == rb)
+      return;
+    parent[ra] = rb;
+    --parts;
+    for_each_on_line(points[a], points[b], [&](IVec2 pos) { tiles[size_t(pos.y) * w + size_t(pos.x)] = dungeon::floor; });
+  };
+  for (const Edge &edge : edges)
+    join(edge.from, edge.to);
+  // clusters further apart than 8 neighbours can stay unconnected, every such part is joined
+  // to the closest point of another part until there's one left
+  while (parts > 1)
+    for (uint32_t i = 0; i < uint32_t(points.size()) && parts > 1; ++i)
+    {
+      if (find_set(parent, i) != i)
+        continue;
+      grid.closest(points[i], 1, [&](uint32_t j) { return find_set(parent, j) != i; }, closest);
+      join(i, closest.front().second);
+    }
+}
 
 void gen_drunk_dungeon(char *tiles, size_t w, size_t h,
-                       const size_t num_iter, const size_t max_excavations)
+                       const size_t num_iter, const size_t max_excavations, rng::Rng &rng)
 {
   memset(tiles, dungeon::wall, w * h);
 
@@ -19,8 +169,8 @@ void gen_drunk_dungeon(char *tiles, size_t w, size_t h,
   for (size_t iter = 0; iter < num_iter; ++iter)
   {
     // select random point on map
-    size_t x = GetRandomValue(1,w-2);
-    size_t y = GetRandomValue(1, h-2);
+    size_t x = size_t(rng.range(1, int(w) - 2));
+    size_t y = size_t(rng.range(1, int(h) - 2));
     startPos.push_back({int(x), int(y)});
     size_t numExcavations = 0;
     while (numExcavations < max_excavations)
@@ -31,7 +181,7 @@ void gen_drunk_dungeon(char *tiles, size_t w, size_t h,
         tiles[y * w + x] = dungeon::floor;
       }
       // choose random dir
-      size_t dir = GetRandomValue(0, 3); // 0 - right, 1 - up, 2 - left, 3 - down
+      size_t dir = size_t(rng.range(0, 3)); // 0 - right, 1 - up, 2 - left, 3 - down
       int newX = (int(x) + dirs[dir][0] + w) % w;
       int newY = (int(y) + dirs[dir][1] + h) % h;
       x = size_t(newX);
@@ -39,43 +189,18 @@ void gen_drunk_dungeon(char *tiles, size_t w, size_t h,
     }
   }
 
-  // construct a path from start pos to all other start poses
-  for (size_t i = 0; i < startPos.size()-1; ++i)
-  {
-    const IVec2 &spos = startPos[i];
-    float closestDistSq = std::numeric_limits<float>::max();
-    IVec2 closestPos = spos;
-    for (size_t j = i+1; j < startPos.size(); ++j)
-    {
-      const IVec2 &epos = startPos[j];
-      const float distSq = dist_sq(spos, epos);
-      if (distSq < closestDistSq)
-      {
-        closestDistSq = distSq;
-        closestPos = epos;
-      }
-    }
-    IVec2 pos = spos;
-    while (dist_sq(pos, closestPos) > 0.f)
-    {
-      const IVec2 delta = closestPos - pos;
-      if (abs(delta.x) > abs(delta.y))
-        pos.x += delta.x > 0 ? 1 : -1;
-      else
-        pos.y += delta.y > 0 ? 1 : -1;
-      tiles[size_t(pos.y) * w + size_t(pos.x)] = dungeon::floor;
-    }
-  }
+  connect_points(tiles, w, h, startPos);
 }
 
-void gen_inv_dungeon(char *tiles, size_t w, size_t h, const size_t max_excavations, const size_t init_sz, const size_t max_steps)
+void gen_inv_dungeon(char *tiles, size_t w, size_t h, const size_t max_excavations, const size_t init_sz, const size_t max_steps,
+                     rng::Rng &rng)
 {
   memset(tiles, dungeon::wall, w * h);
 
   const int dirs[8][2] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1},
                           {1, 1}, {-1, 1}, {1, -1}, {-1, -1},};
 
-  IVec2 spos{GetRandomValue(init_sz + 1, w - init_sz - 1), GetRandomValue(init_sz + 1, h - init_sz - 1)};
+  IVec2 spos{rng.range(int(init_sz) + 1, int(w - init_sz) - 1), rng.range(int(init_sz) + 1, int(h - init_sz) - 1)};
   for (size_t y = spos.y - init_sz; y < spos.y + init_sz; ++y)
     for (size_t x = spos.x - init_sz; x < spos.x + init_sz; ++x)
       tiles[y * w + x] = dungeon::floor;
@@ -86,9 +211,9 @@ void gen_inv_dungeon(char *tiles, size_t w, size_t h, const size_t max_excavatio
     bool shouldExcavate = false;
     while (!shouldExcavate)
     {
-      size_t x = GetRandomValue(1,w-2);
-      size_t y = GetRandomValue(1, h-2);
-      const size_t dir = GetRandomValue(0, 7);
+      size_t x = size_t(rng.range(1, int(w) - 2));
+      size_t y = size_t(rng.range(1, int(h) - 2));
+      const size_t dir = size_t(rng.range(0, 7));
       for (size_t s = 0; s < max_steps && !shouldExcavate; ++s)
       {
         int newX = std::min(std::max(int(x) + dirs[dir][0], 1), int(w) - 2);
@@ -111,19 +236,8 @@ void gen_inv_dungeon(char *tiles, size_t w, size_t h, const size_t max_excavatio
   }
 }
 
-void gen_inv_room_dungeon(char *tiles, size_t w, size_t h, const size_t max_excavations, const size_t init_sz, const size_t max_steps)
-{
-  memset(tiles, dungeon::wall, w * h);
-
-  const int dirs[8][2] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1},
-                          {1, 1}, {-1, 1}, {1, -1}, {-1, -1},};
-
-  IVec2 spos{GetRandomValue(init_sz + 1, w - init_sz - 1), GetRandomValue(init_sz + 1, h - init_sz - 1)};
-  for (size_t y = spos.y - init_sz; y < spos.y + init_sz; ++y)
-    for (size_t x = spos.x - init_sz; x < spos.x + init_sz; ++x)
-      tiles[y * w + x] = dungeon::floor;
-
-  char rooms[][26] = {
+// 5x5 stamps of the room generators, walls are left as they are
+static const char inv_rooms[][26] = {
 "\
 #####\
 #   #\
@@ -159,101 +273,496 @@ void gen_inv_room_dungeon(char *tiles, size_t w, size_t h, const size_t max_exca
 #####\
 #####\
 "
+};
+
+RoomTemplate compile_room(const char *cells, int width, int height)
+{
+  RoomTemplate res;
+  res.width = std::min(width, 64);
+  res.height = height;
+  res.rows.assign(size_t(height), 0);
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < res.width; ++x)
+      if (cells[y * width + x] != dungeon::wall)
+        res.rows[size_t(y)] |= uint64_t(1) << x;
+  return res;
+}
+
+const std::vector<RoomTemplate> &default_rooms()
+{
+  static const std::vector<RoomTemplate> rooms = []()
+  {
+    std::vector<RoomTemplate> res;
+    for (const char *room : inv_rooms)
+      res.push_back(compile_room(room, 5, 5));
+    return res;
+  }();
+  return rooms;
+}
+
+bool load_rooms(const char *path, std::vector<RoomTemplate> &rooms)
+{
+  FILE *file = fopen(path, "r");
+  if (!file)
+  {
+    printf("can't read rooms from %s\n", path);
+    return false;
+  }
+  std::vector<std::string> lines;
+  auto add_room = [&]()
+  {
+    if (lines.empty())
+      return;
+    size_t width = 0;
+    for (const std::string &line : lines)
+      width = std::max(width, line.size());
+    if (width > 64)
+      printf("room %zu in %s is wider than 64, it's cut\n", rooms.size(), path);
+    // short rows are padded with walls
+    std::string cells;
+    for (const std::string &line : lines)
+      cells += line + std::string(width - line.size(), dungeon::wall);
+    RoomTemplate room = compile_room(cells.c_str(), int(width), int(lines.size()));
+    lines.clear();
+    // a room of walls never touches anything, walks would go on forever
+    if (std::any_of(room.rows.begin(), room.rows.end(), [](uint64_t row) { return row != 0; }))
+      rooms.push_back(std::move(room));
   };
-  size_t numExcavations = 0;
+  char buf[256];
+  while (fgets(buf, sizeof(buf), file))
+  {
+    std::string line(buf);
+    while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
+      line.pop_back();
+    if (line.empty())
+      add_room();
+    else
+      lines.push_back(line);
+  }
+  add_room();
+  fclose(file);
+  return !rooms.empty();
+}
+
+// tiles that aren't walls as bits, rooms are tested and stamped a row of the room at a time,
+// margins of empty bits around the map keep rooms hanging over the edge from reading past it
+struct FloorBits
+{
+  size_t width = 0;
+  size_t height = 0;
+  size_t margin = 0;
+  size_t words = 0;
+  std::vector<uint64_t> bits;
+
+  void init(const char *tiles, size_t w, size_t h, const std::vector<RoomTemplate> &rooms)
+  {
+    width = w;
+    height = h;
+    margin = 1;
+    for (const RoomTemplate &room : rooms)
+      margin = std::max(margin, size_t(std::max(room.width, room.height)));
+    // one more word, windows read the word after the one they start in
+    words = (margin + w + 63) / 64 + 1;
+    bits.assign(words * (h + 2 * margin), 0);
+    for (size_t y = 0; y < h; ++y)
+      for (size_t x = 0; x < w; ++x)
+        if (tiles[y * w + x] != dungeon::wall)
+          set(int(x), int(y));
+  }
+
+  uint64_t *row(int y) { return bits.data() + size_t(y + int(margin)) * words; }
+  const uint64_t *row(int y) const { return bits.data() + size_t(y + int(margin)) * words; }
+
+  void set(int x, int y)
+  {
+    const size_t bit = size_t(x + int(margin));
+    row(y)[bit / 64] |= uint64_t(1) << (bit % 64);
+  }
+
+  // tiles x .. x + 63 of row y
+  uint64_t window(int x, int y) const
+  {
+    const uint64_t *r = row(y);
+    const size_t bit = size_t(x + int(margin));
+    const size_t shift = bit % 64;
+    return shift ? (r[bit / 64] >> shift) | (r[bit / 64 + 1] << (64 - shift)) : r[bit / 64];
+  }
+
+  void add_window(int x, int y, uint64_t value)
+  {
+    uint64_t *r = row(y);
+    const size_t bit = size_t(x + int(margin));
+    const size_t shift = bit % 64;
+    r[bit / 64] |= value << shift;
+    if (shift)
+      r[bit / 64 + 1] |= value >> (64 - shift);
+  }
+
+  // any open cell of the room centred at p over floor
+  bool touches(const RoomTemplate &room, IVec2 p) const
+  {
+    const int x0 = p.x - room.width / 2;
+    const int y0 = p.y - room.height / 2;
+    for (int y = 0; y < room.height; ++y)
+      if (window(x0, y0 + y) & room.rows[size_t(y)])
+        return true;
+    return false;
+  }
+
+  // open cells of the room centred at p that are walls and inside the map become floor,
+  // c(x, y) is called for each of them
+  template<typename Callable>
+  void stamp(char *tiles, const RoomTemplate &room, IVec2 p, Callable c)
+  {
+    const int x0 = p.x - room.width / 2;
+    const int y0 = p.y - room.height / 2;
+    // columns of the room that are inside the map
+    const int lo = std::max(-x0, 0);
+    const int hi = std::min(int(width) - x0, room.width);
+    if (lo >= hi)
+      return;
+    const uint64_t inside = (hi - lo == 64 ? ~uint64_t(0) : (uint64_t(1) << (hi - lo)) - 1) << lo;
+    for (int y = std::max(y0, 0); y < std::min(y0 + room.height, int(height)); ++y)
+    {
+      uint64_t added = room.rows[size_t(y - y0)] & inside & ~window(x0, y);
+      add_window(x0, y, added);
+      for (; added; added &= added - 1)
+      {
+        const int x = x0 + std::countr_zero(added);
+        tiles[size_t(y) * width + size_t(x)] = dungeon::floor;
+        c(x, y);
+      }
+    }
+  }
+};
+
+void gen_inv_room_dungeon(char *tiles, size_t w, size_t h, const size_t max_excavations, const size_t init_sz, const size_t max_steps,
+                          const std::vector<RoomTemplate> &rooms, rng::Rng &rng)
+{
+  memset(tiles, dungeon::wall, w * h);
+
+  const int dirs[8][2] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1},
+                          {1, 1}, {-1, 1}, {1, -1}, {-1, -1},};
+
+  IVec2 spos{rng.range(int(init_sz) + 1, int(w - init_sz) - 1), rng.range(int(init_sz) + 1, int(h - init_sz) - 1)};
+  for (size_t y = size_t(spos.y) - init_sz; y < size_t(spos.y) + init_sz; ++y)
+    for (size_t x = size_t(spos.x) - init_sz; x < size_t(spos.x) + init_sz; ++x)
+      tiles[y * w + x] = dungeon::floor;
+
+  FloorBits floorBits;
+  floorBits.init(tiles, w, h, rooms);
   for (size_t i = 0; i < max_excavations; ++i)
   {
     bool shouldExcavate = false;
     while (!shouldExcavate)
     {
-      size_t x = GetRandomValue(1,w-2);
-      size_t y = GetRandomValue(1, h-2);
-      size_t room = GetRandomValue(0, 4);
-      const size_t dir = GetRandomValue(0, 7);
+      IVec2 pos{rng.range(1, int(w) - 2), rng.range(1, int(h) - 2)};
+      const RoomTemplate &room = rooms[size_t(rng.range(0, int(rooms.size()) - 1))];
+      const size_t dir = size_t(rng.range(0, 7));
       for (size_t s = 0; s < max_steps && !shouldExcavate; ++s)
       {
-        int newX = std::min(std::max(int(x) + dirs[dir][0], 1), int(w) - 2);
-        int newY = std::min(std::max(int(y) + dirs[dir][1], 1), int(h) - 2);
-        /*
-        if (tiles[newY * w + newX] != dungeon::wall)
-          break;
-        */
-        x = size_t(newX);
-        y = size_t(newY);
-
-        // check adjacent cells
-        for (int yy = -2; yy <= 2; ++yy)
-          for (int xx = -2; xx <= 2; ++xx)
-          {
-            if (rooms[room][(yy + 2) * 5 + xx + 2] == dungeon::wall)
-              continue;
-            if (y + yy < 0 || x + xx < 0 || y + yy >= h || x + xx >= w)
-              continue;
-            shouldExcavate |= tiles[(y + yy) * w + x + xx] != dungeon::wall;
-          }
+        pos.x = std::min(std::max(pos.x + dirs[dir][0], 1), int(w) - 2);
+        pos.y = std::min(std::max(pos.y + dirs[dir][1], 1), int(h) - 2);
+        shouldExcavate = floorBits.touches(room, pos);
       }
       if (shouldExcavate)
+        floorBits.stamp(tiles, room, pos, [](int, int) {});
+    }
+  }
+}
+
+void gen_inv_room_dungeon(char *tiles, size_t w, size_t h, const size_t max_excavations, const size_t init_sz, const size_t max_steps,
+                          rng::Rng &rng)
+{
+  gen_inv_room_dungeon(tiles, w, h, max_excavations, init_sz, max_steps, default_rooms(), rng);
+}
+
+
+// Positions a walk of the inverse generators can stop at: everything within radius of floor.
+// Floor is never filled back, so the set only grows and each tile is added once.
+struct TouchSet
+{
+  std::vector<uint32_t> positions;
+  std::vector<char> contains;
+
+  void init(size_t w, size_t h)
+  {
+    positions.clear();
+    contains.assign(w * h, 0);
+  }
+
+  // tile x, y just became floor
+  void add_floor(int x, int y, int radius, size_t w, size_t h)
+  {
+    // walks are clamped to the map without its border
+    for (int yy = std::max(y - radius, 1); yy <= std::min(y + radius, int(h) - 2); ++yy)
+      for (int xx = std::max(x - radius, 1); xx <= std::min(x + radius, int(w) - 2); ++xx)
       {
-        for (int yy = -2; yy <= 2; ++yy)
-          for (int xx = -2; xx <= 2; ++xx)
-          {
-            if (y + yy < 0 || x + xx < 0 || y + yy >= h || x + xx >= w)
-              continue;
-            size_t coord = (y + yy) * w + x + xx;
-            if (tiles[coord] == dungeon::wall)
-              tiles[coord] = rooms[room][(yy + 2) * 5 + xx + 2];
-          }
+        const size_t idx = size_t(yy) * w + size_t(xx);
+        if (!contains[idx])
+        {
+          contains[idx] = 1;
+          positions.push_back(uint32_t(idx));
+        }
       }
+  }
+};
+
+// One try at picking where a walk from a random point in a random direction would stop, without
+// walking. A position that touches the dungeon, a direction and a walk length are drawn together
+// and kept if the walk wouldn't have touched anything on its way there, so positions are picked
+// as often as real walks stop at them, but no time goes into walks that never reach anything.
+// The shortest walk always fits, so a try succeeds with a chance of at least 1 / max_steps.
+template<typename Touches>
+static bool try_walk_stop(const TouchSet &set, size_t w, size_t h, size_t max_steps, rng::Rng &rng, IVec2 &pos,
+                          Touches touches)
+{
+  const int dirs[8][2] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1},
+                          {1, 1}, {-1, 1}, {1, -1}, {-1, -1},};
+  const uint32_t idx = set.positions[rng.index(set.positions.size())];
+  pos = IVec2{int(idx % w), int(idx / w)};
+  if (!touches(pos))
+    return false;
+  const int *dir = dirs[rng.range(0, 7)];
+  const int steps = rng.range(1, int(max_steps));
+  // walk started steps tiles back and checked every tile after the start
+  for (int s = 1; s <= steps; ++s)
+  {
+    const IVec2 back{pos.x - dir[0] * s, pos.y - dir[1] * s};
+    if (back.x < 1 || back.y < 1 || back.x > int(w) - 2 || back.y > int(h) - 2)
+      return false;
+    if (s < steps && touches(back))
+      return false;
+  }
+  return true;
+}
+
+void gen_inv_dungeon_frontier(char *tiles, size_t w, size_t h, const size_t max_excavations, const size_t init_sz,
+                              const size_t max_steps, rng::Rng &rng)
+{
+  memset(tiles, dungeon::wall, w * h);
+  TouchSet set;
+  set.init(w, h);
+
+  IVec2 spos{rng.range(int(init_sz) + 1, int(w - init_sz) - 1), rng.range(int(init_sz) + 1, int(h - init_sz) - 1)};
+  for (size_t y = size_t(spos.y) - init_sz; y < size_t(spos.y) + init_sz; ++y)
+    for (size_t x = size_t(spos.x) - init_sz; x < size_t(spos.x) + init_sz; ++x)
+    {
+      tiles[y * w + x] = dungeon::floor;
+      set.add_floor(int(x), int(y), 1, w, h);
+    }
+
+  // same check as gen_inv_dungeon, anything but wall in the 3x3 window
+  auto touches = [&](IVec2 p)
+  {
+    for (int yy = p.y - 1; yy <= p.y + 1; ++yy)
+      for (int xx = p.x - 1; xx <= p.x + 1; ++xx)
+        if (tiles[size_t(yy) * w + size_t(xx)] != dungeon::wall)
+          return true;
+    return false;
+  };
+  for (size_t i = 0; i < max_excavations; ++i)
+  {
+    IVec2 pos;
+    while (!try_walk_stop(set, w, h, max_steps, rng, pos, touches))
+      ;
+    char &tile = tiles[size_t(pos.y) * w + size_t(pos.x)];
+    if (tile == dungeon::wall)
+    {
+      tile = dungeon::floor;
+      set.add_floor(pos.x, pos.y, 1, w, h);
+    }
+  }
+}
+
+void gen_inv_room_dungeon_frontier(char *tiles, size_t w, size_t h, const size_t max_excavations, const size_t init_sz,
+                                   const size_t max_steps, const std::vector<RoomTemplate> &rooms, rng::Rng &rng)
+{
+  memset(tiles, dungeon::wall, w * h);
+  // rooms reach this far from their centre
+  int radius = 0;
+  for (const RoomTemplate &room : rooms)
+    radius = std::max({radius, room.width / 2, room.height / 2});
+  TouchSet set;
+  set.init(w, h);
+
+  IVec2 spos{rng.range(int(init_sz) + 1, int(w - init_sz) - 1), rng.range(int(init_sz) + 1, int(h - init_sz) - 1)};
+  for (size_t y = size_t(spos.y) - init_sz; y < size_t(spos.y) + init_sz; ++y)
+    for (size_t x = size_t(spos.x) - init_sz; x < size_t(spos.x) + init_sz; ++x)
+    {
+      tiles[y * w + x] = dungeon::floor;
+      set.add_floor(int(x), int(y), radius, w, h);
     }
+
+  FloorBits floorBits;
+  floorBits.init(tiles, w, h, rooms);
+  const RoomTemplate *room = nullptr;
+  auto touches = [&](IVec2 p) { return floorBits.touches(*room, p); };
+  for (size_t i = 0; i < max_excavations; ++i)
+  {
+    IVec2 pos;
+    // room is drawn again with every try, rooms that touch more often get picked more often like with walks
+    do
+      room = &rooms[size_t(rng.range(0, int(rooms.size()) - 1))];
+    while (!try_walk_stop(set, w, h, max_steps, rng, pos, touches));
+    floorBits.stamp(tiles, *room, pos, [&](int x, int y) { set.add_floor(x, y, radius, w, h); });
   }
 }
 
+void gen_inv_room_dungeon_frontier(char *tiles, size_t w, size_t h, const size_t max_excavations, const size_t init_sz,
+                                   const size_t max_steps, rng::Rng &rng)
+{
+  gen_inv_room_dungeon_frontier(tiles, w, h, max_excavations, init_sz, max_steps, default_rooms(), rng);
+}
 
-void run_cellular(char *tiles, size_t w, size_t h, const size_t num_iter)
+// 64 tiles per word, bit x % 64 of word x / 64 is tile x of a row, everything outside the map is wall
+constexpr uint64_t all_walls = ~uint64_t(0);
+
+// tiles dx columns away from every tile of word i
+static inline uint64_t shifted(const uint64_t *row, size_t i, size_t words, int dx)
 {
-  char *scratch = new char[w * h];
-  memcpy(scratch, tiles, w * h);
-  for (size_t iter = 0; iter < num_iter; ++iter)
+  if (dx > 0)
   {
-    bool hasChanges = false;
-    for (int y = 0; y < h; ++y)
-      for (int x = 0; x < w; ++x)
+    const uint64_t next = i + 1 < words ? row[i + 1] : all_walls;
+    return (row[i] >> dx) | (next << (64 - dx));
+  }
+  const uint64_t prev = i > 0 ? row[i - 1] : all_walls;
+  return (row[i] << -dx) | (prev >> (64 + dx));
+}
+
+// sum of three bits per lane as sum + 2 * carry
+static inline void full_add(uint64_t a, uint64_t b, uint64_t c, uint64_t &sum, uint64_t &carry)
+{
+  sum = a ^ b ^ c;
+  carry = (a & b) | (c & (a ^ b));
+}
+
+// rows y0 .. y1 of the next generation, true if any tile flipped. Same rule as counting walls
+// tile by tile: a tile becomes a wall with at least 5 walls in its 3x3 window or none in its 5x5 one
+static bool step_rows(const uint64_t *cur, uint64_t *next, size_t w, size_t y0, size_t y1)
+{
+  const size_t words = (w + 63) / 64;
+  // bits past the right edge of the last word have to stay walls
+  const uint64_t outside = w % 64 ? all_walls << (w % 64) : 0;
+  bool hasChanges = false;
+  for (size_t y = y0; y < y1; ++y)
+  {
+    const uint64_t *rows = cur + y * words; // rows y - 2 .. y + 2
+    uint64_t *res = next + (y + 2) * words;
+    for (size_t i = 0; i < words; ++i)
+    {
+      uint64_t any5 = 0;
+      for (size_t r = 0; r < 5; ++r)
       {
-        size_t numWalls1 = 0;
-        size_t numWalls2 = 0;
-        for (int yy = y - 1; yy < y + 2; ++yy)
-          for (int xx = x - 1; xx < x + 2; ++xx)
-            numWalls1 += yy < 0 || xx < 0 || yy >= h || xx >= w || tiles[yy * w + xx] == dungeon::wall;
-        for (int yy = y - 2; yy < y + 3; ++yy)
-          for (int xx = x - 2; xx < x + 3; ++xx)
-            numWalls2 += yy < 0 || xx < 0 || yy >= h || xx >= w || tiles[yy * w + xx] == dungeon::wall;
-
-        const bool shouldBeWall = numWalls1 >= 5 || numWalls2 < 1;
-        const bool shouldFlip = shouldBeWall != (tiles[y * w + x] == dungeon::wall);
-        if (shouldFlip)
-          scratch[y * w + x] = shouldBeWall ? dungeon::wall : dungeon::floor;
-        hasChanges |= shouldFlip;
+        const uint64_t *row = rows + r * words;
+        any5 |= shifted(row, i, words, -2) | shifted(row, i, words, -1) | row[i] |
+                shifted(row, i, words, 1) | shifted(row, i, words, 2);
       }
-    memcpy(tiles, scratch, w * h);
-    if (!hasChanges)
-      break;
+      // 3x3 count: rows are summed horizontally into sum + 2 * carry, then vertically
+      uint64_t sums[3];
+      uint64_t carries[3];
+      for (size_t r = 0; r < 3; ++r)
+      {
+        const uint64_t *row = rows + (r + 1) * words;
+        full_add(shifted(row, i, words, -1), row[i], shifted(row, i, words, 1), sums[r], carries[r]);
+      }
+      uint64_t ones, twosA, twosB, fours;
+      full_add(sums[0], sums[1], sums[2], ones, twosA);
+      full_add(carries[0], carries[1], carries[2], twosB, fours);
+      // count = ones + 2 * (twosA + twosB) + 4 * fours
+      const uint64_t twos = twosA ^ twosB;
+      const uint64_t foursB = twosA & twosB;
+      const uint64_t atLeast5 = (fours & foursB) | ((fours | foursB) & (ones | twos));
+      const uint64_t walls = atLeast5 | ~any5 | (i + 1 == words ? outside : 0);
+      hasChanges |= walls != rows[2 * words + i];
+      res[i] = walls;
+    }
   }
-  delete[] scratch;
+  return hasChanges;
 }
 
+// bands are fixed, so random streams per band don't depend on the number of threads
+constexpr size_t band_rows = 64;
 
-void gen_cellular_dungeon(char *tiles, size_t w, size_t h, const float fillrate, const size_t num_iter)
+// calls c(band, y0, y1) for every band of rows, spread over the pool's workers if there are any
+template<typename Callable>
+static void for_each_band(size_t h, ThreadPool *pool, Callable c)
 {
-  memset(tiles, dungeon::wall, w * h);
+  const size_t numBands = (h + band_rows - 1) / band_rows;
+  if (!pool || pool->size() == 0 || numBands < 2)
+  {
+    for (size_t band = 0; band < numBands; ++band)
+      c(band, band * band_rows, std::min((band + 1) * band_rows, h));
+    return;
+  }
+  JobGraph graph;
+  for (size_t band = 0; band < numBands; ++band)
+    graph.add([&c, band, h]() { c(band, band * band_rows, std::min((band + 1) * band_rows, h)); });
+  graph.run(*pool);
+}
+
+void run_cellular(char *tiles, size_t w, size_t h, const size_t num_iter, CellularBuffers &buffers, ThreadPool *pool)
+{
+  const size_t words = (w + 63) / 64;
+  // two rows of walls above and below, so windows never need a bounds check vertically,
+  // bands only read the previous generation, that is where their halo rows come from
+  buffers.cur.assign(words * (h + 4), all_walls);
+  buffers.next.assign(words * (h + 4), all_walls);
+  for_each_band(h, pool, [&](size_t, size_t y0, size_t y1)
+  {
+    for (size_t y = y0; y < y1; ++y)
+      for (size_t x = 0; x < w; ++x)
+        if (tiles[y * w + x] != dungeon::wall)
+          buffers.cur[(y + 2) * words + x / 64] &= ~(uint64_t(1) << (x % 64));
+  });
+
+  std::vector<char> bandChanged((h + band_rows - 1) / band_rows);
+  for (size_t iter = 0; iter < num_iter; ++iter)
+  {
+    for_each_band(h, pool, [&](size_t band, size_t y0, size_t y1)
+    {
+      bandChanged[band] = step_rows(buffers.cur.data(), buffers.next.data(), w, y0, y1);
+    });
+    std::swap(buffers.cur, buffers.next);
+    if (std::find(bandChanged.begin(), bandChanged.end(), 1) == bandChanged.end())
+      break;
+  }
 
-  // from https://en.cppreference.com/w/cpp/numeric/random/uniform_real_distribution
-  std::random_device rd;  // Will be used to obtain a seed for the random number engine
-  std::mt19937 gen(rd()); // Standard mersenne_twister_engine seeded with rd()
-  std::uniform_real_distribution<> dis(0.0, 1.0);
-  for (size_t y = 0; y < h; ++y)
-    for (size_t x = 0; x < w; ++x)
-      tiles[y * w + x] = dis(gen) < fillrate ? dungeon::wall : dungeon::floor;
+  for_each_band(h, pool, [&](size_t, size_t y0, size_t y1)
+  {
+    for (size_t y = y0; y < y1; ++y)
+      for (size_t x = 0; x < w; ++x)
+        tiles[y * w + x] = (buffers.cur[(y + 2) * words + x / 64] >> (x % 64)) & 1 ? dungeon::wall : dungeon::floor;
+  });
+}
 
-  run_cellular(tiles, w, h, num_iter);
+void run_cellular(char *tiles, size_t w, size_t h, const size_t num_iter)
+{
+  CellularBuffers buffers;
+  run_cellular(tiles, w, h, num_iter, buffers);
 }
 
+
+void gen_cellular_dungeon(char *tiles, size_t w, size_t h, const float fillrate, const size_t num_iter,
+                          rng::Rng &rng, CellularBuffers &buffers, ThreadPool *pool)
+{
+  // every band of rows has its own stream, split off in band order before anything runs
+  std::vector<rng::Rng> streams;
+  for (size_t y = 0; y < h; y += band_rows)
+    streams.push_back(rng.split());
+  for_each_band(h, pool, [&](size_t band, size_t y0, size_t y1)
+  {
+    rng::Rng &stream = streams[band];
+    for (size_t y = y0; y < y1; ++y)
+      for (size_t x = 0; x < w; ++x)
+        tiles[y * w + x] = stream.uniform() < fillrate ? dungeon::wall : dungeon::floor;
+  });
+
+  run_cellular(tiles, w, h, num_iter, buffers, pool);
+}
+
+void gen_cellular_dungeon(char *tiles, size_t w, size_t h, const float fillrate, const size_t num_iter, rng::Rng &rng)
+{
+  CellularBuffers buffers;
+  gen_cellular_dungeon(tiles, w, h, fillrate, num_iter, rng, buffers);
+}
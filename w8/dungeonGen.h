@@ -1,11 +1,91 @@
 #pragma once
 #include <cstddef> // size_t
+#include <cstdint>
+#include <cstdlib> // abs
+#include <vector>
+#include "math.h"
+#include "rng.h"
 
+// integer bresenham from a to b that steps one axis at a time, so the tiles are connected with
+// 4 neighbours, calls c(pos) for every tile including both ends
+template<typename Callable>
+void for_each_on_line(IVec2 a, IVec2 b, Callable c)
+{
+  const int dx = abs(b.x - a.x);
+  const int dy = abs(b.y - a.y);
+  const int sx = b.x > a.x ? 1 : -1;
+  const int sy = b.y > a.y ? 1 : -1;
+  int err = dx - dy;
+  c(a);
+  while (a != b)
+  {
+    // the axis that is further behind the line goes first
+    if (2 * err > -dy)
+    {
+      err -= dy;
+      a.x += sx;
+    }
+    else
+    {
+      err += dx;
+      a.y += sy;
+    }
+    c(a);
+  }
+}
+
+// A room as one bitmask per row, bits are set for open cells, so testing and stamping a room
+// takes a few word operations per row instead of a check per cell. Rooms are up to 64 wide.
+struct RoomTemplate
+{
+  int width = 0;
+  int height = 0;
+  std::vector<uint64_t> rows;
+};
+
+// cells are row-major, anything but a wall is open
+RoomTemplate compile_room(const char *cells, int width, int height);
+// the 5x5 rooms the room generators always had
+const std::vector<RoomTemplate> &default_rooms();
+// rooms drawn with '#' for walls, separated by blank lines, rows shorter than the longest are
+// padded with walls, wider rooms are cut at 64, rooms are added to the ones already there
+bool load_rooms(const char *path, std::vector<RoomTemplate> &rooms);
+
+// generators draw every random number from rng, the same seed makes the same dungeon
 void gen_drunk_dungeon(char *tiles, size_t w, size_t h,
-                       const size_t num_iter, const size_t max_excavations);
+                       const size_t num_iter, const size_t max_excavations, rng::Rng &rng);
+
+void gen_inv_dungeon(char *tiles, size_t w, size_t h, const size_t num_iter, const size_t init_sz, const size_t max_steps,
+                     rng::Rng &rng);
+// rooms are stamped centred on where walks stop, the default ones are 5x5
+void gen_inv_room_dungeon(char *tiles, size_t w, size_t h, const size_t num_iter, const size_t init_sz, const size_t max_steps,
+                          rng::Rng &rng);
+void gen_inv_room_dungeon(char *tiles, size_t w, size_t h, const size_t num_iter, const size_t init_sz, const size_t max_steps,
+                          const std::vector<RoomTemplate> &rooms, rng::Rng &rng);
+// same dungeons as the two above, positions walks stop at are drawn directly from the tiles
+// around floor instead of walking, so every excavation has a bounded cost on any map size
+void gen_inv_dungeon_frontier(char *tiles, size_t w, size_t h, const size_t num_iter, const size_t init_sz,
+                              const size_t max_steps, rng::Rng &rng);
+void gen_inv_room_dungeon_frontier(char *tiles, size_t w, size_t h, const size_t num_iter, const size_t init_sz,
+                                   const size_t max_steps, rng::Rng &rng);
+void gen_inv_room_dungeon_frontier(char *tiles, size_t w, size_t h, const size_t num_iter, const size_t init_sz,
+                                   const size_t max_steps, const std::vector<RoomTemplate> &rooms, rng::Rng &rng);
+
+// one bit per tile (set for walls) with a border of walls, two generations the automaton
+// ping-pongs between, keeping them around saves the allocations when it's run again
+struct CellularBuffers
+{
+  std::vector<uint64_t> cur;
+  std::vector<uint64_t> next;
+};
 
-void gen_inv_dungeon(char *tiles, size_t w, size_t h, const size_t num_iter, const size_t init_sz, const size_t max_steps);
-void gen_inv_room_dungeon(char *tiles, size_t w, size_t h, const size_t num_iter, const size_t init_sz, const size_t max_steps);
+class ThreadPool;
 
-void gen_cellular_dungeon(char *tiles, size_t w, size_t h, const float fillrate, const size_t num_iter);
+// with a pool, bands of rows are processed on its workers, results are the same as without one,
+// bands get their own streams split off rng, so caves don't depend on the number of threads
+void gen_cellular_dungeon(char *tiles, size_t w, size_t h, const float fillrate, const size_t num_iter, rng::Rng &rng);
+void gen_cellular_dungeon(char *tiles, size_t w, size_t h, const float fillrate, const size_t num_iter,
+                          rng::Rng &rng, CellularBuffers &buffers, ThreadPool *pool = nullptr);
 void run_cellular(char *tiles, size_t w, size_t h, const size_t num_iter);
+void run_cellular(char *tiles, size_t w, size_t h, const size_t num_iter, CellularBuffers &buffers,
+                  ThreadPool *pool = nullptr);
@@ -0,0 +1,165 @@
+#pragma once
+#include <cstddef> // size_t
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that live as long as the pool does.
+class ThreadPool
+{
+public:
+  explicit ThreadPool(size_t numThreads = std::max(std::thread::hardware_concurrency(), 2u) - 1)
+  {
+    for (size_t i = 0; i < numThreads; ++i)
+      workers.emplace_back([this]() { work(); });
+  }
+
+  ~ThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    hasTasks.notify_all();
+    for (std::thread &worker : workers)
+      worker.join();
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  void submit(std::function<void()> task)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      tasks.push_back(std::move(task));
+    }
+    hasTasks.notify_one();
+  }
+
+  size_t size() const { return workers.size(); }
+
+private:
+  void work()
+  {
+    while (true)
+    {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        hasTasks.wait(lock, [this]() { return stopping || head < tasks.size(); });
+        if (head == tasks.size())
+          return;
+        task = std::move(tasks[head++]);
+        // queue is a plain vector that is reset once drained, so it doesn't allocate after warming up
+        if (head == tasks.size())
+        {
+          tasks.clear();
+          head = 0;
+        }
+      }
+      task();
+    }
+  }
+
+  std::vector<std::thread> workers;
+  std::vector<std::function<void()>> tasks;
+  size_t head = 0;
+  std::mutex mutex;
+  std::condition_variable hasTasks;
+  bool stopping = false;
+};
+
+// Jobs with dependencies, a job is started as soon as everything it depends on is done.
+// Graph is rebuilt every time it's needed, clearing it keeps all storage around.
+class JobGraph
+{
+public:
+  void clear()
+  {
+    for (size_t id = 0; id < numJobs; ++id)
+      jobs[id].dependents.clear();
+    numJobs = 0;
+  }
+
+  size_t add(std::function<void()> func, std::initializer_list<size_t> deps = {})
+  {
+    const size_t id = numJobs++;
+    if (id == jobs.size())
+      jobs.emplace_back();
+    jobs[id].func = std::move(func);
+    jobs[id].waitingFor = deps.size();
+    for (size_t dep : deps)
+      jobs[dep].dependents.push_back(id);
+    return id;
+  }
+
+  // for dependencies only known at run time, both jobs have to be added already
+  void depend(size_t id, size_t dep)
+  {
+    ++jobs[id].waitingFor;
+    jobs[dep].dependents.push_back(id);
+  }
+
+  // runs all jobs on the pool and blocks until they are finished
+  void run(ThreadPool &pool)
+  {
+    remaining = numJobs;
+    if (pool.size() == 0)
+    {
+      // no workers, jobs are added in dependency order anyway
+      for (size_t id = 0; id < numJobs; ++id)
+        jobs[id].func();
+      remaining = 0;
+      return;
+    }
+    // collect roots first, finished roots start their dependents on their own
+    roots.clear();
+    for (size_t id = 0; id < numJobs; ++id)
+      if (jobs[id].waitingFor == 0)
+        roots.push_back(id);
+    runPool = &pool;
+    for (size_t id : roots)
+      start(id);
+    std::unique_lock<std::mutex> lock(mutex);
+    allDone.wait(lock, [this]() { return remaining == 0; });
+  }
+
+private:
+  struct Job
+  {
+    std::function<void()> func;
+    size_t waitingFor = 0;
+    std::vector<size_t> dependents;
+  };
+
+  void start(size_t id)
+  {
+    // small enough capture for std::function to keep it inline
+    runPool->submit([this, id]() { execute(id); });
+  }
+
+  void execute(size_t id)
+  {
+    jobs[id].func();
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t dependent : jobs[id].dependents)
+      if (--jobs[dependent].waitingFor == 0)
+        start(dependent);
+    // notify under the lock, run() may return and destroy the graph right after
+    if (--remaining == 0)
+      allDone.notify_all();
+  }
+
+  std::vector<Job> jobs;
+  size_t numJobs = 0;
+  std::vector<size_t> roots;
+  ThreadPool *runPool = nullptr;
+  size_t remaining = 0;
+  std::mutex mutex;
+  std::condition_variable allDone;
+};
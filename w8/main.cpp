@@ -1,7 +1,15 @@
 #include "raylib.h"
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
 #include <algorithm>
+#include <memory>
+#include <random>
 
+#include "chunkedWorld.h"
+#include "dungeonFile.h"
 #include "dungeonGen.h"
+#include "jobGraph.h"
 
 void draw_map(const char *tiles, size_t w, size_t h)
 {
@@ -14,8 +22,13 @@ void draw_map(const char *tiles, size_t w, size_t h)
     }
 }
 
-int main(int /*argc*/, const char ** /*argv*/)
+int main(int argc, const char **argv)
 {
+  // pass a seed to get the same dungeons again
+  const uint64_t seed = argc > 1 ? strtoull(argv[1], nullptr, 10) : std::random_device{}();
+  printf("dungeon seed %" PRIu64 "\n", seed);
+  rng::Rng rng(seed);
+
   int width = 1920;
   int height = 1080;
   InitWindow(width, height, "w6 AI MIPT");
@@ -32,21 +45,69 @@ int main(int /*argc*/, const char ** /*argv*/)
   constexpr size_t dungWidth = 130;
   constexpr size_t dungHeight = 130;
   char *tiles = new char[dungWidth * dungHeight];
-  gen_drunk_dungeon(tiles, dungWidth, dungHeight, 1, 1000);
+  gen_drunk_dungeon(tiles, dungWidth, dungHeight, 1, 1000, rng);
+  CellularBuffers cellular;
+  ThreadPool pool;
+  // K saves the dungeon, L loads it back
+  const char *mapPath = argc > 2 ? argv[2] : "dungeon.dng";
+  // C and V show a chunked world instead, arrows scroll around it
+  std::unique_ptr<world::ChunkedWorld> chunkedWorld;
+  IVec2 view{0, 0};
+  // T makes rooms from the file instead of the default ones
+  std::vector<RoomTemplate> rooms;
+  if (!load_rooms("assets/rooms.txt", rooms))
+    rooms = default_rooms();
 
   SetTargetFPS(60);               // Set our game to run at 60 frames-per-second
   while (!WindowShouldClose())
   {
+    if (IsKeyPressed(KEY_Q) || IsKeyPressed(KEY_W) || IsKeyPressed(KEY_E) || IsKeyPressed(KEY_A) ||
+        IsKeyPressed(KEY_R) || IsKeyPressed(KEY_S) || IsKeyPressed(KEY_F) || IsKeyPressed(KEY_T))
+      chunkedWorld.reset();
     if (IsKeyPressed(KEY_Q))
-      gen_drunk_dungeon(tiles, dungWidth, dungHeight, 1, 5000);
+      gen_drunk_dungeon(tiles, dungWidth, dungHeight, 1, 5000, rng);
     if (IsKeyPressed(KEY_W))
-      gen_inv_dungeon(tiles, dungWidth, dungHeight, 3000, 3, 20);
+      gen_inv_dungeon(tiles, dungWidth, dungHeight, 3000, 3, 20, rng);
     if (IsKeyPressed(KEY_E))
-      gen_cellular_dungeon(tiles, dungWidth, dungHeight, 0.45f, 10);
+      gen_cellular_dungeon(tiles, dungWidth, dungHeight, 0.45f, 10, rng, cellular, &pool);
     if (IsKeyPressed(KEY_A))
-      run_cellular(tiles, dungWidth, dungHeight, 10);
+      run_cellular(tiles, dungWidth, dungHeight, 10, cellular, &pool);
     if (IsKeyPressed(KEY_R))
-      gen_inv_room_dungeon(tiles, dungWidth, dungHeight, 200, 3, 20);
+      gen_inv_room_dungeon(tiles, dungWidth, dungHeight, 200, 3, 20, rng);
+    if (IsKeyPressed(KEY_S))
+      gen_inv_dungeon_frontier(tiles, dungWidth, dungHeight, 3000, 3, 20, rng);
+    if (IsKeyPressed(KEY_F))
+      gen_inv_room_dungeon_frontier(tiles, dungWidth, dungHeight, 200, 3, 20, rng);
+    if (IsKeyPressed(KEY_T))
+      gen_inv_room_dungeon_frontier(tiles, dungWidth, dungHeight, 60, 3, 20, rooms, rng);
+    if (IsKeyPressed(KEY_K))
+      mapfile::save(mapPath, mapfile::Info{dungWidth, dungHeight, seed, "w8"}, tiles, nullptr, mapfile::Encoding::bits);
+    if (IsKeyPressed(KEY_L))
+    {
+      mapfile::Dungeon map;
+      const bool loaded = mapfile::load(mapPath, map);
+      if (loaded && (map.info.width != dungWidth || map.info.height != dungHeight))
+        printf("%s is %zux%zu, not %zux%zu\n", mapPath, map.info.width, map.info.height, dungWidth, dungHeight);
+      else if (loaded)
+      {
+        chunkedWorld.reset();
+        std::copy(map.tiles.data(), map.tiles.data() + map.tiles.size(), tiles);
+      }
+    }
+    if (IsKeyPressed(KEY_C) || IsKeyPressed(KEY_V))
+    {
+      world::WorldParams params;
+      params.seed = rng.next();
+      params.gen = IsKeyPressed(KEY_C) ? world::ChunkGen::cellular : world::ChunkGen::drunk;
+      chunkedWorld = std::make_unique<world::ChunkedWorld>(params);
+    }
+    if (chunkedWorld)
+    {
+      view.x += (IsKeyDown(KEY_RIGHT) - IsKeyDown(KEY_LEFT)) * 4;
+      view.y += (IsKeyDown(KEY_DOWN) - IsKeyDown(KEY_UP)) * 4;
+      chunkedWorld->update({IVec2{view.x + int(dungWidth / 2), view.y + int(dungHeight / 2)}});
+      chunkedWorld->copy_region(view.x, view.y, dungWidth, dungHeight, tiles);
+    }
     BeginDrawing();
       ClearBackground(BLACK);
       draw_map(tiles, dungWidth, dungHeight);
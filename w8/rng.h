@@ -0,0 +1,89 @@
+#pragma once
+#include <cstddef> // size_t
+#include <cstdint>
+
+namespace rng
+{
+  // xoshiro256** with explicit seeds and no shared state. Every user owns its generator,
+  // independent streams (per thread, band of rows, entity) come from a seed and a stream id
+  // or are split off an existing generator.
+  class Rng
+  {
+  public:
+    explicit Rng(uint64_t seed = 0, uint64_t stream = 0)
+    {
+      // splitmix64 spreads any seed over the whole state, it's never all zero
+      uint64_t sm = seed ^ mix(stream + 0x9e3779b97f4a7c15ull);
+      for (uint64_t &word : s)
+      {
+        sm += 0x9e3779b97f4a7c15ull;
+        word = mix(sm);
+      }
+    }
+
+    uint64_t next()
+    {
+      const uint64_t res = rotl(s[1] * 5, 7) * 9;
+      const uint64_t t = s[1] << 17;
+      s[2] ^= s[0];
+      s[3] ^= s[1];
+      s[1] ^= s[2];
+      s[0] ^= s[3];
+      s[2] ^= t;
+      s[3] = rotl(s[3], 45);
+      return res;
+    }
+
+    // uniform in [lo, hi], both ends included like raylib's GetRandomValue,
+    // multiply and shift instead of modulo, the bias is below 2^-32
+    int range(int lo, int hi)
+    {
+      const uint64_t span = uint64_t(int64_t(hi) - int64_t(lo) + 1);
+      return int(int64_t(lo) + int64_t(((next() >> 32) * span) >> 32));
+    }
+
+    // uniform in [0, count)
+    size_t index(size_t count) { return ((next() >> 32) * count) >> 32; }
+
+    // uniform in [0, 1)
+    float uniform() { return float(next() >> 40) * (1.f / 16777216.f); }
+
+    // generator that continues from here, this one jumps 2^128 draws ahead,
+    // so the two never produce the same numbers
+    Rng split()
+    {
+      Rng res = *this;
+      jump();
+      return res;
+    }
+
+  private:
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    static uint64_t mix(uint64_t z)
+    {
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+      return z ^ (z >> 31);
+    }
+
+    void jump()
+    {
+      constexpr uint64_t poly[4] = {0x180ec6d33cfd0abaull, 0xd5a61266f0c9392cull, 0xa9582618e03fc9aaull,
+                                    0x39abdc4529b1661cull};
+      uint64_t res[4] = {0, 0, 0, 0};
+      for (uint64_t word : poly)
+        for (int b = 0; b < 64; ++b)
+        {
+          if (word & (uint64_t(1) << b))
+            for (size_t i = 0; i < 4; ++i)
+              res[i] ^= s[i];
+          next();
+        }
+      for (size_t i = 0; i < 4; ++i)
+        s[i] = res[i];
+    }
+
+    uint64_t s[4];
+  };
+};